@@ -3,6 +3,7 @@
 #include "bitboard/enum.h"
 #include "chessboard/board_state.h"
 #include "chessboard/game_state.h"
+#include "datagen/writer.h"
 #include "encode.h"
 #include "evaluation/evaluate.h"
 #include "movegen/list.h"
@@ -15,14 +16,16 @@
 #include "uci/uci.h"
 #include "utility/static_vector.h"
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <cmath>
 #include <compare>
 #include <cstdint>
 #include <cstdlib>
-#include <fstream>
+#include <functional>
 #include <iostream>
+#include <numeric>
 #include <optional>
 #include <random>
 #include <ratio>
@@ -31,31 +34,43 @@
 #include <tuple>
 #include <vector>
 
-void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLimits& limits, std::ofstream& data_file);
+// Each worker counts into its own cache line, so the workers don't contend on shared counters. The info thread sums
+// them.
+struct alignas(hardware_destructive_interference_size) DatagenStats
+{
+    std::atomic<uint64_t> games;
+    std::atomic<uint64_t> fens;
+    std::atomic<uint64_t> white_wins;
+    std::atomic<uint64_t> draws;
+    std::atomic<uint64_t> black_wins;
 
-std::atomic<uint64_t> games;
-std::atomic<uint64_t> fens;
-std::atomic<uint64_t> white_wins;
-std::atomic<uint64_t> draws;
-std::atomic<uint64_t> black_wins;
+    std::atomic<uint64_t> games_eligible_for_adjudication;
+    std::atomic<uint64_t> correct_adjudications;
+};
 
-std::atomic<uint64_t> games_eligible_for_adjudication;
-std::atomic<uint64_t> correct_adjudications;
+uint64_t total(const std::vector<DatagenStats>& stats, std::atomic<uint64_t> DatagenStats::* counter)
+{
+    return std::accumulate(stats.begin(), stats.end(), uint64_t(0),
+        [&](uint64_t sum, const DatagenStats& worker) { return sum + (worker.*counter).load(); });
+}
 
-bool stop = false;
+void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLimits& limits, std::vector<char>& buffer,
+    DatagenStats& stats);
 
-void info_thread(std::chrono::seconds datagen_time)
+std::atomic<bool> stop = false;
+
+void info_thread(std::chrono::seconds datagen_time, const std::vector<DatagenStats>& stats)
 {
     using namespace std::chrono_literals;
 
     std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
     std::chrono::steady_clock::time_point last_print = start;
 
-    uint64_t last_games = games;
-    uint64_t last_fens = fens;
-    uint64_t last_white_wins = white_wins;
-    uint64_t last_draws = draws;
-    uint64_t last_black_wins = black_wins;
+    uint64_t last_games = 0;
+    uint64_t last_fens = 0;
+    uint64_t last_white_wins = 0;
+    uint64_t last_draws = 0;
+    uint64_t last_black_wins = 0;
 
     while (!stop)
     {
@@ -69,6 +84,14 @@ void info_thread(std::chrono::seconds datagen_time)
         {
             auto duration = std::chrono::duration<float>(now - last_print).count();
 
+            const auto games = total(stats, &DatagenStats::games);
+            const auto fens = total(stats, &DatagenStats::fens);
+            const auto white_wins = total(stats, &DatagenStats::white_wins);
+            const auto draws = total(stats, &DatagenStats::draws);
+            const auto black_wins = total(stats, &DatagenStats::black_wins);
+            const auto games_eligible_for_adjudication = total(stats, &DatagenStats::games_eligible_for_adjudication);
+            const auto correct_adjudications = total(stats, &DatagenStats::correct_adjudications);
+
             std::cout << "Games " << games << " (" << int(float(games - last_games) / duration) << "/s)" << std::endl;
             std::cout << "Fens " << fens << " (" << int(float(fens - last_fens) / duration) << "/s)" << std::endl;
             std::cout << "WDL %: ";
@@ -95,7 +118,7 @@ void info_thread(std::chrono::seconds datagen_time)
     }
 }
 
-void generation_thread(std::string_view output_path)
+void generation_thread(DatagenWriter& writer, int worker, DatagenStats& stats)
 {
     UCI::UciOutput output { UCI::OutputLevel::None };
     SearchThreadPool pool { output, 1, 1, 1 };
@@ -104,39 +127,48 @@ void generation_thread(std::string_view output_path)
     limits.nodes = 40000;
 
     GameState position = GameState::starting_position();
-
-    int output_rotation = 0;
-    auto output_file_path = [&] { return std::string(output_path) + std::to_string(output_rotation) + ".data"; };
-    std::ofstream data_file(output_file_path(), std::ios::out | std::ios::binary | std::ios::app);
-    auto last_rotation = std::chrono::steady_clock::now();
+    std::vector<char> buffer;
 
     while (!stop)
     {
         position = GameState::starting_position();
         pool.reset_new_game();
-        self_play_game(position, pool, limits, data_file);
-
-        // rotate output file each hour
-        auto now = std::chrono::steady_clock::now();
-        if ((now - last_rotation) >= std::chrono::hours(1))
-        {
-            last_rotation = std::chrono::steady_clock::now();
-            output_rotation++;
-            data_file = std::ofstream(output_file_path(), std::ios::out | std::ios::binary | std::ios::app);
-        }
+        self_play_game(position, pool, limits, buffer, stats);
+        writer.submit(worker, buffer);
     }
+
+    writer.submit(worker, buffer, true);
 }
 
-void datagen(std::string_view output_path, std::chrono::seconds duration)
+void datagen(std::string_view output_path, std::chrono::seconds duration, int threads)
 {
-    auto info = std::thread(info_thread, duration);
-    auto data = std::thread(generation_thread, output_path);
+    std::vector<DatagenStats> stats(threads);
+    DatagenWriter writer(output_path, threads);
+    auto info = std::thread(info_thread, duration, std::cref(stats));
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; i++)
+    {
+        workers.emplace_back(generation_thread, std::ref(writer), i, std::ref(stats[i]));
+    }
 
     info.join();
-    data.join();
+
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+template <typename T>
+void append(std::vector<char>& buffer, const T& value)
+{
+    const auto* bytes = reinterpret_cast<const char*>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
 }
 
-void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLimits& limits, std::ofstream& data_file)
+void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLimits& limits, std::vector<char>& buffer,
+    DatagenStats& stats)
 {
     thread_local std::random_device rd;
     thread_local std::mt19937 gen(rd());
@@ -227,18 +259,18 @@ void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLim
                 if (position.board().stm == WHITE)
                 {
                     result = 0.f;
-                    black_wins++;
+                    stats.black_wins++;
                 }
                 else
                 {
                     result = 1.f;
-                    white_wins++;
+                    stats.white_wins++;
                 }
             }
             else
             {
                 result = 0.5f;
-                draws++;
+                stats.draws++;
             }
 
             break;
@@ -248,7 +280,7 @@ void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLim
         if (position.board().fifty_move_count >= 100)
         {
             result = 0.5f;
-            draws++;
+            stats.draws++;
             break;
         }
 
@@ -256,7 +288,7 @@ void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLim
         if (position.is_repetition(0))
         {
             result = 0.5f;
-            draws++;
+            stats.draws++;
             break;
         }
 
@@ -264,7 +296,7 @@ void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLim
         if (insufficient_material(position.board()))
         {
             result = 0.5f;
-            draws++;
+            stats.draws++;
             break;
         }
 
@@ -311,19 +343,19 @@ void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLim
             if (white_win_adj_count >= win_adjudication_plys)
             {
                 result = 1.f;
-                white_wins++;
+                stats.white_wins++;
                 break;
             }
             else if (black_win_adj_count >= win_adjudication_plys)
             {
                 result = 0.f;
-                black_wins++;
+                stats.black_wins++;
                 break;
             }
             else if (draw_adj_count >= draw_adjudication_plys)
             {
                 result = 0.5f;
-                draws++;
+                stats.draws++;
                 break;
             }
         }
@@ -354,30 +386,26 @@ void self_play_game(GameState& position, SearchThreadPool& pool, const SearchLim
     // track adjudication accuracy for summary stats
     if (would_be_eligible_for_adjudication)
     {
-        games_eligible_for_adjudication++;
+        stats.games_eligible_for_adjudication++;
         if (potential_adjudication_decision == result)
         {
-            correct_adjudications++;
+            stats.correct_adjudications++;
         }
     }
 
-    auto marlin_format = convert(initial_state, result);
-    data_file.write(reinterpret_cast<const char*>(&marlin_format), sizeof(marlin_format));
+    append(buffer, convert(initial_state, result));
     auto stm = initial_state.stm;
 
     for (const auto& [eval, best_move] : score_moves)
     {
-        auto packed_move = convert(best_move);
-        auto score = convert(stm, eval);
-        data_file.write(reinterpret_cast<const char*>(&packed_move), sizeof(packed_move));
-        data_file.write(reinterpret_cast<const char*>(&score), sizeof(score));
+        append(buffer, convert(best_move));
+        append(buffer, convert(stm, eval));
         stm = !stm;
     }
 
     // terminate the game
-    uint8_t terminator[4] = { 0, 0, 0, 0 };
-    data_file.write(reinterpret_cast<const char*>(terminator), sizeof(terminator));
+    append(buffer, std::array<uint8_t, 4> { 0, 0, 0, 0 });
 
-    games++;
-    fens += score_moves.size();
+    stats.games++;
+    stats.fens += score_moves.size();
 }
@@ -3,4 +3,5 @@
 #include <chrono>
 #include <string_view>
 
-void datagen(std::string_view output_path, std::chrono::seconds duration);
+// Runs threads independent self-play workers, each writing to its own output files
+void datagen(std::string_view output_path, std::chrono::seconds duration, int threads);
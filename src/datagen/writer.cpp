@@ -0,0 +1,114 @@
+#include "datagen/writer.h"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+// A game is a few hundred bytes, so each write covers a few thousand games
+constexpr size_t buffer_capacity = 1 << 20;
+
+// Hand over smaller buffers after this long, so we never lose much data if the process is killed
+constexpr auto max_buffer_age = std::chrono::minutes(1);
+
+}
+
+DatagenWriter::DatagenWriter(std::string_view output_path, int workers)
+    : output_path_(output_path)
+    , last_rotation(std::chrono::steady_clock::now())
+    , last_submit(workers, std::chrono::steady_clock::now())
+{
+    for (int i = 0; i < workers; i++)
+    {
+        files.emplace_back(output_file_path(i), std::ios::out | std::ios::binary | std::ios::app);
+    }
+
+    thread = std::thread([this] { write_loop(); });
+}
+
+DatagenWriter::~DatagenWriter()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+
+    cv.notify_one();
+    thread.join();
+}
+
+void DatagenWriter::submit(int worker, std::vector<char>& buffer, bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+
+    if (!force && buffer.size() < buffer_capacity && now - last_submit[worker] < max_buffer_age)
+    {
+        return;
+    }
+
+    last_submit[worker] = now;
+    std::vector<char> full_buffer;
+    full_buffer.reserve(buffer_capacity + buffer_capacity / 4);
+    std::swap(full_buffer, buffer);
+
+    {
+        std::lock_guard lock(mutex);
+        pending.emplace(worker, std::move(full_buffer));
+    }
+
+    cv.notify_one();
+}
+
+void DatagenWriter::write_loop()
+{
+    while (true)
+    {
+        std::pair<int, std::vector<char>> task;
+
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [this] { return stop || !pending.empty(); });
+
+            if (pending.empty())
+            {
+                // only reached once stopping, with nothing left to write
+                break;
+            }
+
+            task = std::move(pending.front());
+            pending.pop();
+        }
+
+        // rotate output files each hour
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_rotation >= std::chrono::hours(1))
+        {
+            last_rotation = now;
+            output_rotation++;
+
+            for (size_t i = 0; i < files.size(); i++)
+            {
+                files[i] = std::ofstream(output_file_path(i), std::ios::out | std::ios::binary | std::ios::app);
+            }
+        }
+
+        const auto& [worker, buffer] = task;
+        files[worker].write(buffer.data(), buffer.size());
+    }
+
+    for (auto& file : files)
+    {
+        file.flush();
+    }
+}
+
+std::string DatagenWriter::output_file_path(int worker) const
+{
+    return output_path_ + "_" + std::to_string(worker) + "_" + std::to_string(output_rotation) + ".data";
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Writes the finished games from all datagen workers on a dedicated I/O thread, so the workers never stall on the
+// filesystem. Each worker serializes its games into its own buffer and only hands it over once it has grown large, so
+// the writer does a few big sequential writes rather than one small write per move. Each worker has its own output
+// files, which the writer rotates every hour.
+class DatagenWriter
+{
+public:
+    DatagenWriter(std::string_view output_path, int workers);
+
+    // Blocks until every submitted buffer has been written and the files are closed
+    ~DatagenWriter();
+
+    DatagenWriter(const DatagenWriter&) = delete;
+    DatagenWriter& operator=(const DatagenWriter&) = delete;
+    DatagenWriter(DatagenWriter&&) = delete;
+    DatagenWriter& operator=(DatagenWriter&&) = delete;
+
+    // Called by a worker after appending a game to its buffer. Once the buffer is large enough (or old enough), it is
+    // handed to the I/O thread and the worker is left with an empty buffer. Pass force to hand over the buffer
+    // regardless, e.g when the worker is stopping.
+    void submit(int worker, std::vector<char>& buffer, bool force = false);
+
+private:
+    void write_loop();
+    std::string output_file_path(int worker) const;
+
+    const std::string output_path_;
+    int output_rotation = 0;
+    std::chrono::steady_clock::time_point last_rotation;
+    std::vector<std::ofstream> files;
+
+    // when each worker last handed over its buffer. Each entry is only accessed by its own worker
+    std::vector<std::chrono::steady_clock::time_point> last_submit;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::queue<std::pair<int, std::vector<char>>> pending;
+    bool stop = false;
+
+    std::thread thread;
+};
@@ -4,6 +4,7 @@
 #include "bitboard/enum.h"
 #include "chessboard/board_state.h"
 #include "network/network.h"
+#include "network/stats.h"
 #include "search/score.h"
 #include "spsa/tuneable.h"
 
@@ -15,23 +16,36 @@
 
 Score evaluate(const BoardState& board, NN::Accumulator* acc, NN::Network& net)
 {
-    // apply lazy updates to accumulator stack
-    //
-    // we assume the root position always has a valid accumulator, and use pointer arithmatic to get there
-    auto* current = acc;
-    while (!current->acc_is_valid)
-    {
-        current--;
-    }
+    Score eval;
 
-    while (current + 1 <= acc)
+    // A hit skips the accumulator catch-up as well as inference. This accumulator stays invalid, and is brought up to
+    // date from an earlier one if a child position needs it.
+    if (auto cached = net.probe_eval_cache(board.key))
     {
-        net.apply_lazy_updates(*current, *(current + 1));
-        current++;
+        eval = *cached;
+        assert(eval == NN::Network::slow_eval(board));
     }
+    else
+    {
+        // apply lazy updates to accumulator stack
+        //
+        // we assume the root position always has a valid accumulator, and use pointer arithmatic to get there
+        auto* current = acc;
+        while (!current->acc_is_valid)
+        {
+            current--;
+        }
 
-    assert(NN::Network::verify(board, *acc));
-    Score eval = NN::Network::eval(board, *acc);
+        NN::Stats::record(NN::Stats::CATCH_UP_DISTANCE, acc - current);
+        if (current != acc)
+        {
+            net.catch_up(current, acc);
+        }
+
+        assert(net.verify(board, *acc));
+        eval = net.eval(board, *acc);
+        net.store_eval_cache(board.key, eval);
+    }
 
     // Apply material scaling factor
     const auto npMaterial = eval_scale[PAWN] * std::popcount(board.get_pieces_bb(PAWN))
@@ -1,10 +1,16 @@
 #include "king_bucket.h"
 
 #include "bitboard/define.h"
+#include "chessboard/board_state.h"
 #include "movegen/move.h"
 #include "network/simd/accumulator.hpp"
+#include "network/stats.h"
 
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 
 #if defined(USE_SSE4)
@@ -99,9 +105,6 @@ void KingBucketAccumulator::add2sub2(const KingBucketAccumulator& prev, const In
 
 void KingBucketAccumulator::recalculate_from_scratch(const BoardState& board_, const NN::network& net)
 {
-    // use the board we pass in as an argument rather than the one stored in the accumulator, since the stored one
-    // may be stale
-
     *this = {};
     side[WHITE] = net.ft_bias;
     side[BLACK] = net.ft_bias;
@@ -125,17 +128,14 @@ void KingBucketAccumulator::recalculate_from_scratch(const BoardState& board_, c
     acc_is_valid = true;
 }
 
-void KingBucketAccumulator::store_lazy_updates(
-    const BoardState& prev_move_board, const BoardState& post_move_board, Move move)
+void KingBucketUpdate::store(const BoardState& prev_move_board, const BoardState& post_move_board, Move move)
 {
     assert(move != Move::Uninitialized);
 
-    acc_is_valid = false;
     white_requires_recalculation = false;
     black_requires_recalculation = false;
     // n_adds/n_subs and the adds/subs entries they index are fully written by the branches below on
-    // every path, and `board` is read only on a recalculation (where it is set to post_move_board), so
-    // none of them need clearing here.
+    // every path, so none of them need clearing here.
 
     auto stm = prev_move_board.stm;
     auto from_sq = move.from();
@@ -162,8 +162,6 @@ void KingBucketAccumulator::store_lazy_updates(
         {
             black_requires_recalculation = true;
         }
-
-        board = post_move_board;
     }
 
     if (move.is_castle())
@@ -236,13 +234,15 @@ void KingBucketAccumulator::store_lazy_updates(
     }
 }
 
-void KingBucketAccumulator::apply_lazy_updates(
-    const KingBucketAccumulator& prev_acc, AccumulatorTable& table, const NN::network& net)
+void KingBucketAccumulator::apply_lazy_updates(const KingBucketAccumulator& prev_acc, const KingBucketUpdate& update,
+    const BoardState& post_move_board, AccumulatorTable& table, const NN::network& net)
 {
+    const auto& [white_requires_recalculation, black_requires_recalculation, adds, n_adds, subs, n_subs] = update;
+
     if (white_requires_recalculation)
     {
         // King changed bucket for white — recalculate from table (sets kb + psq for WHITE)
-        table.recalculate(*this, board, WHITE, board.get_king_sq(WHITE), net);
+        table.recalculate(*this, post_move_board, WHITE, post_move_board.get_king_sq(WHITE), net);
 
         // Incrementally update BLACK (kb + psq fused)
         if (n_adds == 1 && n_subs == 1)
@@ -262,7 +262,7 @@ void KingBucketAccumulator::apply_lazy_updates(
     else if (black_requires_recalculation)
     {
         // King changed bucket for black — recalculate from table (sets kb + psq for BLACK)
-        table.recalculate(*this, board, BLACK, board.get_king_sq(BLACK), net);
+        table.recalculate(*this, post_move_board, BLACK, post_move_board.get_king_sq(BLACK), net);
 
         // Incrementally update WHITE (kb + psq fused)
         if (n_adds == 1 && n_subs == 1)
@@ -307,6 +307,14 @@ void AccumulatorTable::recalculate(
         + (enum_to<File>(king_sq) <= FILE_D ? 0 : KingBucket::KING_BUCKET_COUNT)];
     auto& bb = side == WHITE ? entry.white_bb : entry.black_bb;
 
+    // Gather every changed feature first, then apply them all in a single pass over the accumulator. Each chunk of the
+    // accumulator stays in registers while all the weight rows are added, rather than being loaded and stored once per
+    // changed feature.
+    std::array<const int16_t*, 32> adds;
+    std::array<const int16_t*, 32> subs;
+    size_t n_adds = 0;
+    size_t n_subs = 0;
+
     for (const auto& piece : {
              WHITE_PAWN,
              WHITE_KNIGHT,
@@ -331,18 +339,28 @@ void AccumulatorTable::recalculate(
         while (to_add)
         {
             auto sq = lsbpop(to_add);
-            entry.acc.add_input({ king_sq, sq, piece }, side, net);
+            assert(n_adds < adds.size());
+            adds[n_adds++] = net.ft_weight[index(king_sq, sq, piece, side)].data();
         }
 
         while (to_sub)
         {
             auto sq = lsbpop(to_sub);
-            entry.acc.sub_input({ king_sq, sq, piece }, side, net);
+            assert(n_subs < subs.size());
+            subs[n_subs++] = net.ft_weight[index(king_sq, sq, piece, side)].data();
         }
 
         old_bb = new_bb;
     }
 
+    // A hit is a cached entry close enough to this position to need fewer rows than building it from the bias
+    const size_t scratch_rows = std::popcount(board.get_pieces_bb());
+    Stats::increment(Stats::KING_BUCKET_REFRESHES);
+    Stats::increment(Stats::FINNY_HITS, n_adds + n_subs < scratch_rows);
+    Stats::increment(Stats::FINNY_ROWS, n_adds + n_subs);
+    Stats::increment(Stats::FINNY_SCRATCH_ROWS, scratch_rows);
+
+    NN::add_n_sub_n(entry.acc.side[side], entry.acc.side[side], adds.data(), n_adds, subs.data(), n_subs);
     acc.side[side] = entry.acc.side[side];
 }
 
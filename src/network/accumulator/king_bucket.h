@@ -1,7 +1,6 @@
 #pragma once
 
 #include "bitboard/enum.h"
-#include "chessboard/board_state.h"
 #include "network/arch.hpp"
 #include "network/inputs/king_bucket.h"
 
@@ -9,12 +8,14 @@
 #include <cstddef>
 #include <cstdint>
 
+class BoardState;
 class Move;
 
 namespace NN::KingBucket
 {
 
 struct AccumulatorTable;
+struct KingBucketUpdate;
 
 // Accumulator for king-bucketed piece-square inputs.
 // The 'side' array stores: bias + king-bucketed weights combined.
@@ -65,17 +66,26 @@ struct KingBucketAccumulator
         const InputPair& s2, const NN::network& net);
 
     void recalculate_from_scratch(const BoardState& board_, const NN::network& net);
-    void store_lazy_updates(const BoardState& prev_move_board, const BoardState& post_move_board, Move move);
-    void apply_lazy_updates(const KingBucketAccumulator& prev_acc, AccumulatorTable& table, const NN::network& net);
+    void apply_lazy_updates(const KingBucketAccumulator& prev_acc, const KingBucketUpdate& update,
+        const BoardState& post_move_board, AccumulatorTable& table, const NN::network& net);
 
     bool acc_is_valid = false;
+};
+
+// The king-bucketed inputs changed by a single move. This is only needed between computing and applying a lazy
+// update, so each thread keeps one rather than storing it next to every accumulator on the stack.
+struct KingBucketUpdate
+{
+    using InputPair = KingBucketAccumulator::InputPair;
+
+    void store(const BoardState& prev_move_board, const BoardState& post_move_board, Move move);
+
     bool white_requires_recalculation = false;
     bool black_requires_recalculation = false;
     std::array<InputPair, 2> adds = {};
     size_t n_adds = 0;
     std::array<InputPair, 2> subs = {};
     size_t n_subs = 0;
-    BoardState board;
 };
 
 // An accumulator table entry caches the king-bucketed accumulator for a particular king position.
@@ -5,8 +5,14 @@
 #include "movegen/movegen.h"
 #include "network/inputs/threat.h"
 #include "network/simd/accumulator.hpp"
+#include "network/stats.h"
 
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 #if defined(USE_SSE4)
 #include <immintrin.h>
@@ -274,8 +280,7 @@ void collect_threats_to_plus_xray(const BoardState& add_board, const BoardState&
 //   - collect_threats_to: gets threats where the piece is the VICTIM, excluding attackers that are
 //     themselves in the changed set (they'll be counted via their own collect_threats_from)
 //   - x-ray: excludes changed squares as both sliders and victims
-void ThreatAccumulator::store_lazy_updates(
-    const BoardState& prev_board, const BoardState& post_board, uint64_t sub_bb, uint64_t add_bb)
+void ThreatUpdate::store(const BoardState& prev_board, const BoardState& post_board, uint64_t sub_bb, uint64_t add_bb)
 {
     n_threat_adds = 0;
     n_threat_subs = 0;
@@ -387,6 +392,24 @@ void ThreatAccumulator::store_lazy_updates(
                 threat_subs[n_threat_subs++] = td;
             });
     }
+
+    // The collection above never records a threat as both removed and re-added, even for the x-ray updates, so there
+    // is nothing to cancel before the weight rows are gathered.
+    assert(!has_matching_deltas());
+    Stats::record(Stats::THREAT_DELTAS_PER_MOVE, n_threat_adds + n_threat_subs);
+}
+
+bool ThreatUpdate::has_matching_deltas() const
+{
+    static_assert(sizeof(ThreatDelta) == sizeof(uint32_t));
+    auto key = [](const ThreatDelta& td) { return std::bit_cast<uint32_t>(td); };
+
+    return std::any_of(threat_adds.begin(), threat_adds.begin() + n_threat_adds,
+        [&](const ThreatDelta& add)
+        {
+            return std::any_of(threat_subs.begin(), threat_subs.begin() + n_threat_subs,
+                [&](const ThreatDelta& sub) { return key(add) == key(sub); });
+        });
 }
 
 // Compute all threats from scratch for a given board position.
@@ -401,8 +424,8 @@ void ThreatAccumulator::recalculate_side_from_scratch(const BoardState& board, c
 {
     side[perspective] = {};
 
-    w_king = board.get_king_sq(WHITE);
-    b_king = board.get_king_sq(BLACK);
+    auto w_king = board.get_king_sq(WHITE);
+    auto b_king = board.get_king_sq(BLACK);
 
     for (int piece_idx = 0; piece_idx < N_PIECES; piece_idx++)
     {
@@ -434,9 +457,13 @@ void ThreatAccumulator::recalculate_side_from_scratch(const BoardState& board, c
 }
 
 // Apply stored threat deltas to produce the new threat accumulator from the previous one.
-void ThreatAccumulator::apply_lazy_updates(
-    const ThreatAccumulator& prev, const BoardState& board, const NN::network& net)
+void ThreatAccumulator::apply_lazy_updates(const ThreatAccumulator& prev, const ThreatUpdate& update,
+    const BoardState& board, ThreatRefreshTable& table, const NN::network& net)
 {
+    const auto& [white_threats_requires_recalculation, black_threats_requires_recalculation, w_king, b_king,
+        threat_adds, n_threat_adds, threat_subs, n_threat_subs]
+        = update;
+
     std::array<uint32_t, MAX_THREAT_DELTAS> w_add_delta_indicies;
     std::array<uint32_t, MAX_THREAT_DELTAS> w_sub_delta_indicies;
     std::array<uint32_t, MAX_THREAT_DELTAS> b_add_delta_indicies;
@@ -501,6 +528,10 @@ void ThreatAccumulator::apply_lazy_updates(
         }
     }
 
+    Stats::increment(Stats::THREAT_UPDATES);
+    Stats::increment(Stats::THREAT_ROWS_GATHERED,
+        w_add_delta_indicies_size + w_sub_delta_indicies_size + b_add_delta_indicies_size + b_sub_delta_indicies_size);
+
     auto gather = [&net](std::array<const int8_t*, MAX_THREAT_DELTAS>& ptrs, const uint32_t* indicies, size_t n)
     {
         for (size_t i = 0; i < n; i++)
@@ -512,7 +543,7 @@ void ThreatAccumulator::apply_lazy_updates(
 
     if (white_threats_requires_recalculation)
     {
-        recalculate_side_from_scratch(board, net, WHITE);
+        table.recalculate(*this, board, WHITE, net);
         assert(w_sub_delta_indicies_size == 0 && w_add_delta_indicies_size == 0);
         std::array<const int8_t*, MAX_THREAT_DELTAS> b_add_ptrs;
         std::array<const int8_t*, MAX_THREAT_DELTAS> b_sub_ptrs;
@@ -523,7 +554,7 @@ void ThreatAccumulator::apply_lazy_updates(
     }
     else if (black_threats_requires_recalculation)
     {
-        recalculate_side_from_scratch(board, net, BLACK);
+        table.recalculate(*this, board, BLACK, net);
         assert(b_sub_delta_indicies_size == 0 && b_add_delta_indicies_size == 0);
         std::array<const int8_t*, MAX_THREAT_DELTAS> w_add_ptrs;
         std::array<const int8_t*, MAX_THREAT_DELTAS> w_sub_ptrs;
@@ -551,4 +582,100 @@ void ThreatAccumulator::apply_lazy_updates(
     acc_is_valid = true;
 }
 
+void ThreatRefreshTable::recalculate(
+    ThreatAccumulator& acc, const BoardState& board, Side perspective, const NN::network& net)
+{
+    const auto king_sq = board.get_king_sq(perspective);
+    auto& entry = entries[perspective][enum_to<File>(king_sq) <= FILE_D ? 0 : 1];
+    Stats::increment(Stats::THREAT_REFRESHES);
+
+    std::array<uint32_t, ThreatRefreshEntry::MAX_ACTIVE_THREATS> features;
+    size_t n_features = 0;
+
+    for (int piece_idx = 0; piece_idx < N_PIECES; piece_idx++)
+    {
+        Piece atk_piece = static_cast<Piece>(piece_idx);
+        PieceType atk_pt = enum_to<PieceType>(atk_piece);
+        Side atk_color = enum_to<Side>(atk_piece);
+
+        uint64_t atk_bb = board.get_pieces_bb(atk_piece);
+        while (atk_bb)
+        {
+            Square atk_sq = lsbpop(atk_bb);
+            uint64_t attacked = get_threat_targets(atk_pt, atk_color, atk_sq, board);
+
+            while (attacked)
+            {
+                Square vic_sq = lsbpop(attacked);
+                Piece vic_piece = board.get_square_piece(vic_sq);
+
+                assert(n_features < features.size());
+                features[n_features++] = (perspective == WHITE)
+                    ? get_threat_index<WHITE>(atk_piece, atk_sq, vic_piece, vic_sq, king_sq)
+                    : get_threat_index<BLACK>(atk_piece, atk_sq, vic_piece, vic_sq, king_sq);
+            }
+        }
+    }
+
+    std::sort(features.begin(), features.begin() + n_features);
+
+    // walk both sorted feature lists to find the symmetric difference
+    std::array<const int8_t*, ThreatRefreshEntry::MAX_ACTIVE_THREATS> add_ptrs;
+    std::array<const int8_t*, ThreatRefreshEntry::MAX_ACTIVE_THREATS> sub_ptrs;
+    size_t n_adds = 0;
+    size_t n_subs = 0;
+    size_t i = 0;
+    size_t j = 0;
+
+    while (i < n_features || j < entry.n_features)
+    {
+        if (j == entry.n_features || (i < n_features && features[i] < entry.features[j]))
+        {
+            add_ptrs[n_adds++] = net.ft_threat_weight[features[i++]].data();
+        }
+        else if (i == n_features || entry.features[j] < features[i])
+        {
+            sub_ptrs[n_subs++] = net.ft_threat_weight[entry.features[j++]].data();
+        }
+        else
+        {
+            i++;
+            j++;
+        }
+    }
+
+    if (n_adds + n_subs < n_features)
+    {
+        NN::add_n_sub_n(entry.acc, entry.acc, add_ptrs.data(), n_adds, sub_ptrs.data(), n_subs);
+    }
+    else
+    {
+        // the positions have little in common, so it's cheaper to start from an empty accumulator
+        for (size_t k = 0; k < n_features; k++)
+        {
+            add_ptrs[k] = net.ft_threat_weight[features[k]].data();
+        }
+
+        alignas(64) static constexpr std::array<int16_t, FT_SIZE> empty = {};
+        NN::add_n_sub_n(entry.acc, empty, add_ptrs.data(), n_features, sub_ptrs.data(), 0);
+    }
+
+    entry.features = features;
+    entry.n_features = n_features;
+
+    acc.side[perspective] = entry.acc;
+}
+
+void ThreatRefreshTable::reset_table()
+{
+    for (auto& side_entries : entries)
+    {
+        for (auto& entry : side_entries)
+        {
+            entry.acc = {};
+            entry.n_features = 0;
+        }
+    }
+}
+
 }
\ No newline at end of file
@@ -12,8 +12,12 @@ class BoardState;
 namespace NN::Threats
 {
 
+// Maximum number of threat deltas per move. A move changes at most 4 squares (castling),
+// each square can be involved in threats as attacker and victim, plus discovered attacks.
+constexpr size_t MAX_THREAT_DELTAS = 256;
+
 // A single threat, stored as the original attacker->victim description. w_king and b_king are same for all
-// ThreatDeltas, so they are stored in the accumulator
+// ThreatDeltas, so they are stored in the ThreatUpdate
 struct ThreatDelta
 {
     Piece atk_piece;
@@ -22,22 +26,17 @@ struct ThreatDelta
     Square vic_sq;
 };
 
-// Threat input accumulator. Stores threat feature contributions per side (WHITE/BLACK perspective).
-// Incrementally updated via threat deltas computed in store_lazy_updates.
-struct ThreatAccumulator
+// The threat features changed by a single move. Like KingBucket::KingBucketUpdate, this is only needed between
+// computing and applying a lazy update, so each thread keeps one rather than storing it next to every accumulator.
+struct ThreatUpdate
 {
-    alignas(64) std::array<std::array<int16_t, FT_SIZE>, N_SIDES> side = {};
+    void store(const BoardState& prev_board, const BoardState& post_board, uint64_t sub_bb, uint64_t add_bb);
 
-    bool operator==(const ThreatAccumulator& rhs) const;
-
-    // Maximum number of threat deltas per move. A move changes at most 4 squares (castling),
-    // each square can be involved in threats as attacker and victim, plus discovered attacks.
-    static constexpr size_t MAX_THREAT_DELTAS = 256;
+    // Returns true if a threat appears in both threat_adds and threat_subs, whose weight rows would cancel out
+    bool has_matching_deltas() const;
 
-    // data for lazy updates
     bool white_threats_requires_recalculation = false;
     bool black_threats_requires_recalculation = false;
-    bool acc_is_valid = false;
 
     // Threat deltas: features to add and subtract from the previous accumulator
     Square w_king;
@@ -46,16 +45,50 @@ struct ThreatAccumulator
     size_t n_threat_adds = 0;
     std::array<ThreatDelta, MAX_THREAT_DELTAS> threat_subs = {};
     size_t n_threat_subs = 0;
+};
+
+struct ThreatRefreshTable;
+
+// Threat input accumulator. Stores threat feature contributions per side (WHITE/BLACK perspective).
+// Incrementally updated via threat deltas computed in ThreatUpdate::store.
+struct ThreatAccumulator
+{
+    alignas(64) std::array<std::array<int16_t, FT_SIZE>, N_SIDES> side = {};
+
+    bool operator==(const ThreatAccumulator& rhs) const;
 
-    void store_lazy_updates(
-        const BoardState& prev_board, const BoardState& post_board, uint64_t sub_bb, uint64_t add_bb);
+    bool acc_is_valid = false;
 
     // Compute all threats from scratch for a given board position.
     void recalculate_from_scratch(const BoardState& board, const NN::network& net);
     void recalculate_side_from_scratch(const BoardState& board, const NN::network& net, Side perspective);
 
     // Apply stored threat deltas to produce the new threat accumulator from the previous one.
-    void apply_lazy_updates(const ThreatAccumulator& prev, const BoardState& board, const NN::network& net);
+    void apply_lazy_updates(const ThreatAccumulator& prev, const ThreatUpdate& update, const BoardState& board,
+        ThreatRefreshTable& table, const NN::network& net);
+};
+
+// A threat refresh entry caches the threat accumulator for one perspective and mirror state, along with the sorted
+// threat features it was built from. Each of the (at most 32) pieces has at most 8 targets, which bounds the features.
+struct ThreatRefreshEntry
+{
+    static constexpr size_t MAX_ACTIVE_THREATS = 256;
+
+    alignas(64) std::array<int16_t, FT_SIZE> acc = {};
+    std::array<uint32_t, MAX_ACTIVE_THREATS> features = {};
+    size_t n_features = 0;
+};
+
+// A cache of threat accumulators, analogous to KingBucket::AccumulatorTable. When the king crosses the mirror line
+// every threat feature changes index, so rather than rebuilding the accumulator from nothing we start from the entry
+// for the new mirror state and only apply the threats that differ from when it was last used.
+struct ThreatRefreshTable
+{
+    std::array<std::array<ThreatRefreshEntry, 2>, N_SIDES> entries = {};
+
+    void recalculate(ThreatAccumulator& acc, const BoardState& board, Side perspective, const NN::network& net);
+
+    void reset_table();
 };
 
 }
\ No newline at end of file
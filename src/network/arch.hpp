@@ -41,6 +41,14 @@ constexpr int16_t FT_SCALE = 255;
 constexpr int16_t L1_SCALE = 64;
 TUNEABLE_CONSTANT float SCALE_FACTOR = 192.5f;
 
+// Quantization factors for the integer L2 and L3 path. The L1 activations are quantized to [0, L1_INT_ONE] and the L2
+// weights to int16 with L2_SCALE. The L2 activations are then rescaled to [0, L2_INT_ONE], and multiplied with the L3
+// weights quantized with L3_SCALE. tools/verbatim.cpp checks that neither layer can overflow an int32.
+constexpr int32_t L1_INT_ONE = 127 * 16;
+constexpr int32_t L2_SCALE = 1024;
+constexpr int32_t L2_INT_ONE = 127 * 64;
+constexpr int32_t L3_SCALE = 512;
+
 struct network
 {
     alignas(64) std::array<std::array<int16_t, FT_SIZE>, KingBucket::TOTAL_KING_BUCKET_INPUTS> ft_weight = {};
@@ -52,6 +60,45 @@ struct network
     alignas(64) std::array<std::array<float, L2_SIZE>, OUTPUT_BUCKETS> l2_bias = {};
     alignas(64) std::array<std::array<float, L2_SIZE>, OUTPUT_BUCKETS> l3_weight = {};
     alignas(64) std::array<float, OUTPUT_BUCKETS> l3_bias = {};
+
+    // quantized copies of l2 and l3 for the integer inference path
+    alignas(64) std::array<std::array<int16_t, L1_SIZE * 2 * L2_SIZE>, OUTPUT_BUCKETS> l2_weight_int = {};
+    alignas(64) std::array<std::array<int32_t, L2_SIZE>, OUTPUT_BUCKETS> l2_bias_int = {};
+    alignas(64) std::array<std::array<int32_t, L2_SIZE>, OUTPUT_BUCKETS> l3_weight_int = {};
+    alignas(64) std::array<int32_t, OUTPUT_BUCKETS> l3_bias_int = {};
 };
 
+// Bump whenever the layout of the network struct changes
+constexpr uint32_t NETWORK_VERSION = 2;
+
+// tools/verbatim.cpp permutes the weights to suit the SIMD instructions used during inference, so a preprocessed
+// network can only be used by a binary built for the same architecture.
+constexpr uint32_t preprocessed_layout()
+{
+    uint32_t layout = 0;
+#if defined(USE_AVX512)
+    layout = 3;
+#elif defined(USE_AVX2)
+    layout = 2;
+#elif defined(USE_SSE4) || defined(USE_NEON)
+    layout = 1;
+#endif
+#ifdef NETWORK_SHUFFLE
+    layout |= 1 << 8;
+#endif
+    return layout;
+}
+
+// Written by tools/verbatim.cpp ahead of the network weights. Padded to 64 bytes so the weights that follow stay
+// aligned.
+struct alignas(64) network_header
+{
+    std::array<char, 8> magic = { 'H', 'A', 'L', 'O', 'G', 'E', 'N', 'N' };
+    uint32_t version = NETWORK_VERSION;
+    uint32_t layout = preprocessed_layout();
+    uint64_t size = sizeof(network);
+};
+
+static_assert(sizeof(network_header) == 64);
+
 }
\ No newline at end of file
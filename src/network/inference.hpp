@@ -8,15 +8,18 @@
 #include "simd/utility.hpp"
 #include "tools/sparse_shuffle.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 
 namespace NN::Features
 {
 
-void FT_activation(const std::array<int16_t, FT_SIZE>& stm_king_square,
+inline void FT_activation(const std::array<int16_t, FT_SIZE>& stm_king_square,
     const std::array<int16_t, FT_SIZE>& nstm_king_square, const std::array<int16_t, FT_SIZE>& stm_threat,
     const std::array<int16_t, FT_SIZE>& nstm_threat, std::array<uint8_t, FT_SIZE>& output,
     [[maybe_unused]] std::array<int16_t, FT_SIZE / 4>& sparse_nibbles, [[maybe_unused]] size_t& sparse_nibbles_size)
@@ -215,10 +218,11 @@ void FT_activation(const std::array<int16_t, FT_SIZE>& stm_king_square,
 #endif
 }
 
-void L1_activation(const std::array<uint8_t, FT_SIZE>& ft_activation,
+// Calculates the L1 pre-activations, on a scale of 127 * L1_SCALE
+inline void L1_affine(const std::array<uint8_t, FT_SIZE>& ft_activation,
     const std::array<int8_t, FT_SIZE * L1_SIZE>& l1_weight, const std::array<int32_t, L1_SIZE>& l1_bias,
     [[maybe_unused]] const std::array<int16_t, FT_SIZE / 4>& sparse_nibbles,
-    [[maybe_unused]] const size_t sparse_nibbles_size, std::array<float, L1_SIZE * 2>& output)
+    [[maybe_unused]] const size_t sparse_nibbles_size, std::array<int32_t, L1_SIZE>& output)
 {
 #ifdef NETWORK_SHUFFLE
     shuffle_network_data.report_ft_activations(ft_activation);
@@ -376,13 +380,37 @@ void L1_activation(const std::array<uint8_t, FT_SIZE>& ft_activation,
     }
 #endif
 
+    for (size_t j = 0; j < L1_SIZE; j += stride)
+    {
+        SIMD::store(&output[j], output_reg[j / stride]);
+    }
+#else
+    for (size_t i = 0; i < L1_SIZE; i++)
+    {
+        int32_t int_output = l1_bias[i];
+
+        for (size_t j = 0; j < FT_SIZE; j++)
+        {
+            int_output += ft_activation[j] * l1_weight[i * FT_SIZE + j];
+        }
+
+        output[i] = int_output;
+    }
+#endif
+}
+
+inline void L1_activation(
+    const std::array<int32_t, L1_SIZE>& l1_output, std::array<float, L1_SIZE * 2>& output)
+{
+#if defined(SIMD_ENABLED)
+    constexpr auto stride = SIMD::vec_size / sizeof(int32_t);
     const auto zero = SIMD::setzero<SIMD::vecf32>();
     const auto one = SIMD::set_f32(1.f);
     const auto one_reciprocal = SIMD::set_f32(1.f / (127.f * L1_SCALE)); // 127 to match FT_activation adjustment
 
     for (size_t k = 0; k < L1_SIZE; k += stride)
     {
-        auto crelu = SIMD::i32_to_f32(output_reg[k / stride]);
+        auto crelu = SIMD::i32_to_f32(SIMD::load(&l1_output[k]));
         crelu = SIMD::mul_f32(crelu, one_reciprocal);
         auto screlu = SIMD::mul_f32(crelu, crelu);
         crelu = SIMD::max_f32(zero, crelu);
@@ -394,22 +422,32 @@ void L1_activation(const std::array<uint8_t, FT_SIZE>& ft_activation,
 #else
     for (size_t i = 0; i < L1_SIZE; i++)
     {
-        int32_t int_output = l1_bias[i];
-
-        for (size_t j = 0; j < FT_SIZE; j++)
-        {
-            int_output += ft_activation[j] * l1_weight[i * FT_SIZE + j];
-        }
-
         // 127 to match the FT_activation adjustment
-        float float_output = (float)int_output * float(1.f / (127 * L1_SCALE));
+        float float_output = (float)l1_output[i] * float(1.f / (127 * L1_SCALE));
         output[i] = std::clamp(float_output, 0.f, 1.f);
         output[i + L1_SIZE] = std::clamp(float_output * float_output, 0.f, 1.f);
     }
 #endif
 }
 
-void L2_activation(const std::array<float, L1_SIZE * 2>& l1_activation,
+// The integer equivalent of L1_activation, quantizing the activations to [0, L1_INT_ONE]. Integer results don't depend
+// on the order of operations, so unlike the float path we leave vectorizing this and L3_activation_int to the compiler.
+inline void L1_activation_int(
+    const std::array<int32_t, L1_SIZE>& l1_output, std::array<int16_t, L1_SIZE * 2>& output)
+{
+    constexpr int32_t one = 127 * L1_SCALE;
+    static_assert(one % L1_INT_ONE == 0 && (one * one) % L1_INT_ONE == 0);
+
+    for (size_t i = 0; i < L1_SIZE; i++)
+    {
+        const auto crelu = std::clamp(l1_output[i], 0, one);
+        const auto abs = static_cast<uint32_t>(std::min(std::abs(l1_output[i]), one));
+        output[i] = static_cast<int16_t>(crelu / (one / L1_INT_ONE));
+        output[i + L1_SIZE] = static_cast<int16_t>(abs * abs / uint32_t(one * one / L1_INT_ONE));
+    }
+}
+
+inline void L2_activation(const std::array<float, L1_SIZE * 2>& l1_activation,
     const std::array<std::array<float, L2_SIZE>, L1_SIZE * 2>& l2_weight, const std::array<float, L2_SIZE>& l2_bias,
     std::array<float, L2_SIZE>& output)
 {
@@ -466,7 +504,67 @@ void L2_activation(const std::array<float, L1_SIZE * 2>& l1_activation,
 #endif
 }
 
-void L3_activation(
+#if defined(SIMD_ENABLED)
+// The number of positions L2_activation_batch evaluates together, chosen so their accumulators take 8 registers
+constexpr size_t L2_BATCH_SIZE = std::max<size_t>(1, 8 / (L2_SIZE / (SIMD::vec_size / sizeof(float))));
+#else
+constexpr size_t L2_BATCH_SIZE = 1;
+#endif
+
+// Computes L2_activation for L2_BATCH_SIZE positions that share an output bucket. Each weight vector is loaded once
+// and used for every position. Each position's outputs are accumulated in the same order as in L2_activation, so the
+// results are identical.
+inline void L2_activation_batch(const std::array<const std::array<float, L1_SIZE * 2>*, L2_BATCH_SIZE>& l1_activations,
+    const std::array<std::array<float, L2_SIZE>, L1_SIZE * 2>& l2_weight, const std::array<float, L2_SIZE>& l2_bias,
+    const std::array<std::array<float, L2_SIZE>*, L2_BATCH_SIZE>& outputs)
+{
+#if defined(SIMD_ENABLED)
+    constexpr auto stride = SIMD::vec_size / sizeof(float);
+    SIMD::vecf32 l2_reg[L2_BATCH_SIZE][L2_SIZE / stride];
+
+    for (size_t b = 0; b < L2_BATCH_SIZE; b++)
+    {
+        for (size_t i = 0; i < L2_SIZE; i += stride)
+        {
+            l2_reg[b][i / stride] = SIMD::load(&l2_bias[i]);
+        }
+    }
+
+    for (size_t i = 0; i < L1_SIZE * 2; i++)
+    {
+        for (size_t j = 0; j < L2_SIZE; j += stride)
+        {
+            const auto weight = SIMD::load(&l2_weight[i][j]);
+            for (size_t b = 0; b < L2_BATCH_SIZE; b++)
+            {
+                const auto input = SIMD::set_f32((*l1_activations[b])[i]);
+                l2_reg[b][j / stride] = SIMD::fmadd_f32(input, weight, l2_reg[b][j / stride]);
+            }
+        }
+    }
+
+    const auto zero = SIMD::setzero<SIMD::vecf32>();
+    const auto one = SIMD::set_f32(1.f);
+
+    for (size_t b = 0; b < L2_BATCH_SIZE; b++)
+    {
+        for (size_t i = 0; i < L2_SIZE; i += stride)
+        {
+            auto result = l2_reg[b][i / stride];
+            result = SIMD::max_f32(result, zero);
+            result = SIMD::min_f32(result, one);
+            SIMD::store(&(*outputs[b])[i], result);
+        }
+    }
+#else
+    for (size_t b = 0; b < L2_BATCH_SIZE; b++)
+    {
+        L2_activation(*l1_activations[b], l2_weight, l2_bias, *outputs[b]);
+    }
+#endif
+}
+
+inline void L3_activation(
     const std::array<float, L2_SIZE>& l2_activation, const std::array<float, L2_SIZE>& l3_weight, float& output)
 {
 #if defined(SIMD_ENABLED)
@@ -524,4 +622,69 @@ void L3_activation(
     output += results[0];
 #endif
 }
-}
\ No newline at end of file
+
+// The integer equivalent of L2_activation. Outputs are clamped to [0, L1_INT_ONE * L2_SCALE].
+inline void L2_activation_int(const std::array<int16_t, L1_SIZE * 2>& l1_activation,
+    const std::array<int16_t, L1_SIZE * 2 * L2_SIZE>& l2_weight, const std::array<int32_t, L2_SIZE>& l2_bias,
+    std::array<int32_t, L2_SIZE>& output)
+{
+#if defined(SIMD_ENABLED)
+    constexpr auto stride = SIMD::vec_size / sizeof(int32_t);
+    static_assert(L2_SIZE % stride == 0);
+    SIMD::veci32 l2_reg[L2_SIZE / stride];
+
+    for (size_t j = 0; j < L2_SIZE; j += stride)
+    {
+        l2_reg[j / stride] = SIMD::load(&l2_bias[j]);
+    }
+
+    // The weights are interleaved in pairs of inputs, so each pair can be broadcast and used with madd. The pair is
+    // copied rather than read through a uint32_t pointer, which would alias the int16 activations.
+    for (size_t i = 0; i < L1_SIZE * 2 / 2; i++)
+    {
+        uint32_t input_pair;
+        std::memcpy(&input_pair, &l1_activation[i * 2], sizeof(input_pair));
+        const auto input = SIMD::set_i16_from_u32(input_pair);
+        for (size_t j = 0; j < L2_SIZE; j += stride)
+        {
+            l2_reg[j / stride]
+                = SIMD::madd_i16_i32(l2_reg[j / stride], input, SIMD::load(&l2_weight[i * (2 * L2_SIZE) + j * 2]));
+        }
+    }
+
+    const auto zero = SIMD::setzero<SIMD::veci32>();
+    const auto one = SIMD::set_i32(L1_INT_ONE * L2_SCALE);
+
+    for (size_t j = 0; j < L2_SIZE; j += stride)
+    {
+        auto result = SIMD::max_i32(l2_reg[j / stride], zero);
+        result = SIMD::min_i32(result, one);
+        SIMD::store(&output[j], result);
+    }
+#else
+    for (size_t j = 0; j < L2_SIZE; j++)
+    {
+        int32_t sum = l2_bias[j];
+        for (size_t i = 0; i < L1_SIZE * 2; i++)
+        {
+            sum += l1_activation[i] * l2_weight[(i / 2) * (2 * L2_SIZE) + j * 2 + i % 2];
+        }
+        output[j] = std::clamp(sum, 0, L1_INT_ONE * L2_SCALE);
+    }
+#endif
+}
+
+// Rescales the L2 activations to [0, L2_INT_ONE], and returns the network output on a scale of L2_INT_ONE * L3_SCALE
+inline int32_t L3_activation_int(const std::array<int32_t, L2_SIZE>& l2_activation,
+    const std::array<int32_t, L2_SIZE>& l3_weight, int32_t l3_bias)
+{
+    static_assert((L1_INT_ONE * L2_SCALE) % L2_INT_ONE == 0);
+
+    int32_t output = l3_bias;
+    for (size_t i = 0; i < L2_SIZE; i++)
+    {
+        output += l2_activation[i] / (L1_INT_ONE * L2_SCALE / L2_INT_ONE) * l3_weight[i];
+    }
+    return output;
+}
+}
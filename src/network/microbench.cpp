@@ -0,0 +1,373 @@
+#include "microbench.h"
+
+#include "bitboard/enum.h"
+#include "chessboard/board_state.h"
+#include "chessboard/game_state.h"
+#include "misc/benchmark.h"
+#include "movegen/list.h"
+#include "movegen/move.h"
+#include "movegen/movegen.h"
+#include "network/accumulator/king_bucket.h"
+#include "network/accumulator/threat.h"
+#include "network/arch.hpp"
+#include "network/inference.hpp"
+#include "network/network.h"
+#include "utility/arch.h"
+
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace NN
+{
+
+namespace
+{
+
+// The intermediate results of evaluating one position, so that each stage can be timed on its real inputs
+struct Activations
+{
+    alignas(64) std::array<uint8_t, FT_SIZE> ft;
+    alignas(64) std::array<int16_t, FT_SIZE / 4> sparse_nibbles;
+    size_t sparse_nibbles_size = 0;
+    int output_bucket = 0;
+    alignas(64) std::array<int32_t, L1_SIZE> l1_output;
+    alignas(64) std::array<float, L1_SIZE * 2> l1;
+    alignas(64) std::array<int16_t, L1_SIZE * 2> l1_int;
+    alignas(64) std::array<float, L2_SIZE> l2;
+    alignas(64) std::array<int32_t, L2_SIZE> l2_int;
+    float output = 0;
+    int32_t output_int = 0;
+};
+
+// A legal move from one of the positions, with its input changes precomputed
+struct Transition
+{
+    size_t parent;
+    size_t child;
+    AccumulatorUpdate update;
+};
+
+// Stops the compiler from assuming memory is unchanged across calls, or that stores to it are never read, so that
+// repeating a stage isn't optimized away
+void clobber_memory()
+{
+    asm volatile("" : : : "memory");
+}
+
+// Returns the average time in nanoseconds of each of the ops calls made by run_once, repeating it for at least 100ms
+template <typename F>
+double ns_per_op(size_t ops, F&& run_once)
+{
+    using namespace std::chrono;
+
+    // warm up the caches, and any lazily initialized state
+    run_once();
+    clobber_memory();
+
+    size_t rounds = 0;
+    const auto start = steady_clock::now();
+    auto elapsed = steady_clock::duration::zero();
+    do
+    {
+        run_once();
+        clobber_memory();
+        rounds++;
+        elapsed = steady_clock::now() - start;
+    } while (elapsed < milliseconds(100));
+
+    return duration<double, std::nano>(elapsed).count() / static_cast<double>(rounds * ops);
+}
+
+void print_result(std::ostream& os, std::string_view name, size_t ops, double ns)
+{
+    os << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(1) << std::setw(9) << ns
+       << " ns/op (" << ops << " ops)" << std::defaultfloat << "\n";
+}
+
+}
+
+void run_microbench(std::ostream& os)
+{
+    const network& net = get_network(0);
+
+    std::vector<BoardState> boards;
+    std::vector<Transition> transitions;
+    for (const auto& fen : benchMarkPositions)
+    {
+        auto game = GameState::from_fen(fen);
+        const size_t parent = boards.size();
+        boards.push_back(game.board());
+        BasicMoveList moves;
+        legal_moves(game.board(), moves);
+        for (const auto& move : moves)
+        {
+            game.apply_move(move);
+            transitions.push_back({ parent, boards.size(), {} });
+            boards.push_back(game.board());
+            Accumulator marked;
+            marked.prev_move_board = &boards[parent];
+            marked.post_move_board = &game.board();
+            marked.move = move;
+            transitions.back().update.store(marked);
+            game.revert_move();
+        }
+    }
+
+    const size_t n = boards.size();
+    std::vector<Accumulator> accs(n);
+    auto activations = std::make_unique<Activations[]>(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        accs[i].recalculate(boards[i], net);
+        activations[i].output_bucket = calculate_output_bucket(std::popcount(boards[i].get_pieces_bb()));
+    }
+
+    os << "network microbench: " << arch_name() << ", " << n << " positions, " << transitions.size() << " moves\n";
+
+    // inference
+
+    print_result(os, "FT_activation", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    const auto stm = boards[i].stm;
+                    auto& a = activations[i];
+                    a.sparse_nibbles_size = 0;
+                    Features::FT_activation(accs[i].king_bucket.side[stm], accs[i].king_bucket.side[!stm],
+                        accs[i].threats.side[stm], accs[i].threats.side[!stm], a.ft, a.sparse_nibbles,
+                        a.sparse_nibbles_size);
+                }
+            }));
+
+    const auto l1_affine = [&](size_t i)
+    {
+        auto& a = activations[i];
+        Features::L1_affine(a.ft, net.l1_weight[a.output_bucket], net.l1_bias[a.output_bucket], a.sparse_nibbles,
+            a.sparse_nibbles_size, a.l1_output);
+    };
+
+    print_result(os, "L1_affine", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    l1_affine(i);
+                }
+            }));
+
+    // The sparse L1 only multiplies the non-zero blocks of 4 FT activations, so its cost depends on how many there are
+    constexpr size_t nnz_bin_width = 16;
+    std::array<std::vector<size_t>, FT_SIZE / 4 / nnz_bin_width + 1> nnz_bins;
+    for (size_t i = 0; i < n; i++)
+    {
+        nnz_bins[activations[i].sparse_nibbles_size / nnz_bin_width].push_back(i);
+    }
+
+    for (size_t bin = 0; bin < nnz_bins.size(); bin++)
+    {
+        const auto& positions = nnz_bins[bin];
+        if (positions.empty())
+        {
+            continue;
+        }
+
+        const auto name = "  nnz blocks " + std::to_string(bin * nnz_bin_width) + "-"
+            + std::to_string((bin + 1) * nnz_bin_width - 1);
+        print_result(os, name, positions.size(),
+            ns_per_op(positions.size(),
+                [&]
+                {
+                    for (auto i : positions)
+                    {
+                        l1_affine(i);
+                    }
+                }));
+    }
+
+    print_result(os, "L1_activation", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    Features::L1_activation(activations[i].l1_output, activations[i].l1);
+                }
+            }));
+
+    print_result(os, "L1_activation_int", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    Features::L1_activation_int(activations[i].l1_output, activations[i].l1_int);
+                }
+            }));
+
+    print_result(os, "L2_activation", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    auto& a = activations[i];
+                    Features::L2_activation(a.l1, net.l2_weight[a.output_bucket], net.l2_bias[a.output_bucket], a.l2);
+                }
+            }));
+
+    print_result(os, "L2_activation_int", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    auto& a = activations[i];
+                    Features::L2_activation_int(
+                        a.l1_int, net.l2_weight_int[a.output_bucket], net.l2_bias_int[a.output_bucket], a.l2_int);
+                }
+            }));
+
+    print_result(os, "L3_activation", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    auto& a = activations[i];
+                    a.output = net.l3_bias[a.output_bucket];
+                    Features::L3_activation(a.l2, net.l3_weight[a.output_bucket], a.output);
+                }
+            }));
+
+    print_result(os, "L3_activation_int", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    auto& a = activations[i];
+                    a.output_int = Features::L3_activation_int(
+                        a.l2_int, net.l3_weight_int[a.output_bucket], net.l3_bias_int[a.output_bucket]);
+                }
+            }));
+
+    Network network(0);
+    std::vector<Score> scores(n);
+    print_result(os, "Network::eval", n,
+        ns_per_op(n,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    scores[i] = network.eval(boards[i], accs[i]);
+                }
+            }));
+
+    // accumulator updates
+
+    std::vector<const Transition*> add1sub1;
+    std::vector<const Transition*> add1sub2;
+    std::vector<const Transition*> add2sub2;
+    std::vector<const Transition*> threat_updates;
+    for (const auto& transition : transitions)
+    {
+        const auto& king_bucket = transition.update.king_bucket;
+        if (!king_bucket.white_requires_recalculation && !king_bucket.black_requires_recalculation)
+        {
+            if (king_bucket.n_adds == 1 && king_bucket.n_subs == 1)
+            {
+                add1sub1.push_back(&transition);
+            }
+            else if (king_bucket.n_adds == 1 && king_bucket.n_subs == 2)
+            {
+                add1sub2.push_back(&transition);
+            }
+            else if (king_bucket.n_adds == 2 && king_bucket.n_subs == 2)
+            {
+                add2sub2.push_back(&transition);
+            }
+        }
+
+        const auto& threats = transition.update.threats;
+        if (!threats.white_threats_requires_recalculation && !threats.black_threats_requires_recalculation)
+        {
+            threat_updates.push_back(&transition);
+        }
+    }
+
+    auto king_bucket_acc = std::make_unique<KingBucket::KingBucketAccumulator>();
+    const auto time_king_bucket = [&](std::string_view name, const std::vector<const Transition*>& moves, auto&& apply)
+    {
+        if (moves.empty())
+        {
+            return;
+        }
+
+        print_result(os, name, moves.size(),
+            ns_per_op(moves.size(),
+                [&]
+                {
+                    for (const auto* transition : moves)
+                    {
+                        apply(accs[transition->parent].king_bucket, transition->update.king_bucket);
+                    }
+                }));
+    };
+
+    time_king_bucket("KingBucket add1sub1", add1sub1,
+        [&](const auto& prev, const auto& update)
+        { king_bucket_acc->add1sub1(prev, update.adds[0], update.subs[0], net); });
+    time_king_bucket("KingBucket add1sub2", add1sub2,
+        [&](const auto& prev, const auto& update)
+        { king_bucket_acc->add1sub2(prev, update.adds[0], update.subs[0], update.subs[1], net); });
+    time_king_bucket("KingBucket add2sub2", add2sub2,
+        [&](const auto& prev, const auto& update)
+        { king_bucket_acc->add2sub2(prev, update.adds[0], update.adds[1], update.subs[0], update.subs[1], net); });
+
+    // Each refresh starts from the table entry left by the previous position with the same king bucket, which is
+    // usually a different bench position, so this is closer to the worst case than to a refresh during search
+    auto table = std::make_unique<KingBucket::AccumulatorTable>();
+    table->reset_table(net.ft_bias);
+    print_result(os, "AccumulatorTable::recalculate", n * 2,
+        ns_per_op(n * 2,
+            [&]
+            {
+                for (size_t i = 0; i < n; i++)
+                {
+                    for (auto side : { WHITE, BLACK })
+                    {
+                        table->recalculate(*king_bucket_acc, boards[i], side, boards[i].get_king_sq(side), net);
+                    }
+                }
+            }));
+
+    auto threat_acc = std::make_unique<Threats::ThreatAccumulator>();
+    auto threat_table = std::make_unique<Threats::ThreatRefreshTable>();
+    threat_table->reset_table();
+    print_result(os, "ThreatAccumulator lazy update", threat_updates.size(),
+        ns_per_op(threat_updates.size(),
+            [&]
+            {
+                for (const auto* transition : threat_updates)
+                {
+                    threat_acc->apply_lazy_updates(accs[transition->parent].threats, transition->update.threats,
+                        boards[transition->child], *threat_table, net);
+                }
+            }));
+
+    os.flush();
+}
+
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <iosfwd>
+
+namespace NN
+{
+
+// Times each stage of network inference and accumulator updates in isolation, using the bench positions and every
+// position one legal move away from them. Prints the average time per call of each stage to os.
+void run_microbench(std::ostream& os);
+
+}
@@ -8,15 +8,31 @@
 #include "network/accumulator/threat.h"
 #include "network/arch.hpp"
 #include "network/inference.hpp"
+#include "network/inputs/king_bucket.h"
+#include "network/inputs/threat.h"
+#include "network/simd/accumulator.hpp"
+#include "network/stats.h"
+#include "numa/numa.h"
 #include "third-party/incbin/incbin.h"
+#include "utility/mapped_file.h"
 
 #include <algorithm>
 #include <array>
 #include <bit>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 namespace NN
 {
@@ -25,20 +41,177 @@ namespace NN
 #define INCBIN_ALIGNMENT 64
 INCBIN(Net, EVALFILE);
 
-const network& net = reinterpret_cast<const network&>(*gNetData);
+// A network along with the memory it lives in, which is freed once neither new searches nor any search thread use it
+struct LoadedNetwork
+{
+    const network* net;
+    std::unique_ptr<MappedFile> file;
+    std::unique_ptr<const PerNumaAllocation<network>> replicas;
+
+    // Unique to each load, so evals cached with one network are never mistaken for another's, even if the new network
+    // is mapped where an old one was
+    uint64_t id;
+
+    const network& get(size_t thread_index) const
+    {
+        return replicas ? *replicas->get(thread_index) : *net;
+    }
+};
+
+namespace
+{
+
+// Returns a description of why a preprocessed network can't be used by this binary, or nullopt if it can
+std::optional<std::string> check_network(const std::byte* data, size_t size)
+{
+    if (size < sizeof(network_header))
+    {
+        return "is too small to contain a network header";
+    }
+
+    const auto& header = reinterpret_cast<const network_header&>(*data);
+    const network_header expected;
+
+    if (header.magic != expected.magic)
+    {
+        return "is not a preprocessed network";
+    }
+
+    if (header.version != expected.version)
+    {
+        return "has format version " + std::to_string(header.version) + ", expected "
+            + std::to_string(expected.version);
+    }
+
+    if (header.layout != expected.layout)
+    {
+        return "was preprocessed for a different architecture";
+    }
+
+    if (header.size != expected.size || size != sizeof(network_header) + sizeof(network))
+    {
+        return "is not the expected size. Expected " + std::to_string(sizeof(network_header) + sizeof(network))
+            + " bytes actual " + std::to_string(size) + " bytes";
+    }
 
-[[maybe_unused]] auto verify_network_size = []
+    return std::nullopt;
+}
+
+[[maybe_unused]] auto verify_embedded_network = []
 {
-    if (sizeof(network) != gNetSize)
+    if (auto error = check_network(reinterpret_cast<const std::byte*>(gNetData), gNetSize))
     {
-        std::cout << "Error: embedded network is not the expected size. Expected " << sizeof(network)
-                  << " bytes actual " << gNetSize << " bytes." << std::endl;
+        std::cout << "Error: embedded network " << *error << "." << std::endl;
         std::exit(EXIT_FAILURE);
     }
     return true;
 }();
 
-void Accumulator::recalculate(const BoardState& board_)
+const network& embedded_net = reinterpret_cast<const network&>(*(gNetData + sizeof(network_header)));
+
+// The feature transformer weights are streamed from memory on every accumulator update, so threads reading them from
+// another node's memory pay for it on every move. We give each NUMA node its own copy. With a single node we read the
+// active network directly and avoid the copy.
+std::unique_ptr<const PerNumaAllocation<network>> replicate(const network& net)
+{
+    return get_numa_node_count() > 1 ? std::make_unique<const PerNumaAllocation<network>>(net) : nullptr;
+}
+
+uint64_t network_loads = 0;
+
+std::shared_ptr<const LoadedNetwork> make_loaded_network(const network& net, std::unique_ptr<MappedFile> file)
+{
+    return std::make_shared<const LoadedNetwork>(&net, std::move(file), replicate(net), ++network_loads);
+}
+
+// The network used by new searches. Either the embedded network, or one loaded from an EvalFile. Each Network keeps
+// the one it was last reset with, so loading a new one never frees weights a search thread still points to.
+std::shared_ptr<const LoadedNetwork> active_net = make_loaded_network(embedded_net, nullptr);
+
+size_t eval_cache_size_kb = 0;
+
+bool integer_inference = false;
+
+constexpr uint64_t EVAL_CACHE_KEY_MASK = ~uint64_t(0xFFFF);
+
+}
+
+const network& get_network(size_t thread_index)
+{
+    return active_net->get(thread_index);
+}
+
+bool load_network(std::string_view path, bool print)
+{
+    if (path == "<internal>")
+    {
+        if (active_net->file)
+        {
+            active_net = make_loaded_network(embedded_net, nullptr);
+        }
+        return true;
+    }
+
+    auto file = MappedFile::open(std::string(path));
+    if (!file)
+    {
+        std::cout << "info string Error: unable to open network file " << path << std::endl;
+        return false;
+    }
+
+    if (auto error = check_network(file->data(), file->size()))
+    {
+        std::cout << "info string Error: network file " << path << " " << *error << std::endl;
+        return false;
+    }
+
+    const auto& net = reinterpret_cast<const network&>(*(file->data() + sizeof(network_header)));
+    active_net = make_loaded_network(net, std::move(file));
+
+    if (print)
+    {
+        std::cout << "info string Loaded network file " << path << std::endl;
+    }
+
+    return true;
+}
+
+uint64_t network_hash()
+{
+    static_assert(sizeof(network) % sizeof(uint64_t) == 0);
+
+    // FNV-1a, taken over whole words rather than bytes
+    const auto* data = reinterpret_cast<const std::byte*>(active_net->net);
+    uint64_t hash = 0xcbf29ce484222325;
+    for (size_t i = 0; i < sizeof(network); i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 0x100000001b3;
+    }
+
+    return hash;
+}
+
+void set_eval_cache_size(size_t size_kb)
+{
+    eval_cache_size_kb = size_kb;
+}
+
+void set_integer_inference(bool enabled)
+{
+    integer_inference = enabled;
+}
+
+Network::Network(size_t thread_index)
+    : thread_index_(thread_index)
+    , loaded_net_(active_net)
+    , net_(&loaded_net_->get(thread_index))
+    , integer_inference_(integer_inference)
+{
+}
+
+void Accumulator::recalculate(const BoardState& board_, const network& net)
 {
     king_bucket.recalculate_from_scratch(board_, net);
     threats.recalculate_from_scratch(board_, net);
@@ -51,15 +224,61 @@ void Accumulator::recalculate(const BoardState& board_)
 
 void Network::reset_new_search(const BoardState& board, Accumulator& acc)
 {
-    acc.recalculate(board);
-    table.reset_table(net.ft_bias);
+    // pick up any network loaded since the last search
+    const uint64_t old_net_id = std::exchange(loaded_net_, active_net)->id;
+    net_ = &loaded_net_->get(thread_index_);
+    const bool old_integer_inference = std::exchange(integer_inference_, integer_inference);
+    acc.recalculate(board, *net_);
+    table.reset_table(net_->ft_bias);
+    threat_table.reset_table();
+
+    // and any change to the eval cache size. Cached evals are kept between searches unless the network changed
+    const size_t entries = eval_cache_size_kb == 0 ? 0 : std::bit_floor(eval_cache_size_kb * 1024 / sizeof(uint64_t));
+    if (eval_cache.size() != entries)
+    {
+        eval_cache.assign(entries, 0);
+    }
+    else if (old_net_id != loaded_net_->id || old_integer_inference != integer_inference_)
+    {
+        std::ranges::fill(eval_cache, 0);
+    }
+}
+
+std::optional<Score> Network::probe_eval_cache(uint64_t key)
+{
+    if (eval_cache.empty())
+    {
+        return std::nullopt;
+    }
+
+    Stats::increment(Stats::EVAL_CACHE_PROBES);
+    const auto entry = eval_cache[key & (eval_cache.size() - 1)];
+    if (entry == 0 || (entry & EVAL_CACHE_KEY_MASK) != (key & EVAL_CACHE_KEY_MASK))
+    {
+        return std::nullopt;
+    }
+
+    Stats::increment(Stats::EVAL_CACHE_HITS);
+    return static_cast<int16_t>(entry & ~EVAL_CACHE_KEY_MASK);
 }
 
-bool Network::verify(const BoardState& board, const Accumulator& acc)
+void Network::store_eval_cache(uint64_t key, Score eval)
+{
+    if (eval_cache.empty() || eval.value() < std::numeric_limits<int16_t>::min()
+        || eval.value() > std::numeric_limits<int16_t>::max())
+    {
+        return;
+    }
+
+    eval_cache[key & (eval_cache.size() - 1)]
+        = (key & EVAL_CACHE_KEY_MASK) | static_cast<uint16_t>(static_cast<int16_t>(eval.value()));
+}
+
+bool Network::verify(const BoardState& board, const Accumulator& acc) const
 {
     Accumulator expected = {};
-    expected.king_bucket.recalculate_from_scratch(board, net);
-    expected.threats.recalculate_from_scratch(board, net);
+    expected.king_bucket.recalculate_from_scratch(board, *net_);
+    expected.threats.recalculate_from_scratch(board, *net_);
     expected.acc_is_valid = true;
 
     assert(acc.king_bucket == expected.king_bucket);
@@ -72,28 +291,30 @@ void Network::mark_lazy_update(
     const BoardState& prev_move_board, const BoardState& post_move_board, Accumulator& acc, Move move)
 {
     acc.acc_is_valid = false;
+    acc.king_bucket.acc_is_valid = false;
+    acc.threats.acc_is_valid = false;
     acc.prev_move_board = &prev_move_board;
     acc.post_move_board = &post_move_board;
     acc.move = move;
 }
 
-static void compute_lazy_updates(Accumulator& acc)
+void AccumulatorUpdate::store(const Accumulator& acc)
 {
     const BoardState& prev_move_board = *acc.prev_move_board;
     const BoardState& post_move_board = *acc.post_move_board;
     const Move move = acc.move;
 
-    acc.king_bucket.store_lazy_updates(prev_move_board, post_move_board, move);
+    king_bucket.store(prev_move_board, post_move_board, move);
 
     uint64_t sub_bb = 0;
-    for (size_t i = 0; i < acc.king_bucket.n_subs; i++)
-        sub_bb |= SquareBB[acc.king_bucket.subs[i].piece_sq];
+    for (size_t i = 0; i < king_bucket.n_subs; i++)
+        sub_bb |= SquareBB[king_bucket.subs[i].piece_sq];
     uint64_t add_bb = 0;
-    for (size_t i = 0; i < acc.king_bucket.n_adds; i++)
-        add_bb |= SquareBB[acc.king_bucket.adds[i].piece_sq];
+    for (size_t i = 0; i < king_bucket.n_adds; i++)
+        add_bb |= SquareBB[king_bucket.adds[i].piece_sq];
 
-    acc.threats.white_threats_requires_recalculation = false;
-    acc.threats.black_threats_requires_recalculation = false;
+    threats.white_threats_requires_recalculation = false;
+    threats.black_threats_requires_recalculation = false;
 
     // don't use move.from() and move.to() because castle moves are encoded as KxR
     auto stm = prev_move_board.stm;
@@ -104,15 +325,15 @@ static void compute_lazy_updates(Accumulator& acc)
     {
         if (stm == WHITE)
         {
-            acc.threats.white_threats_requires_recalculation = true;
+            threats.white_threats_requires_recalculation = true;
         }
         else
         {
-            acc.threats.black_threats_requires_recalculation = true;
+            threats.black_threats_requires_recalculation = true;
         }
     }
 
-    acc.threats.store_lazy_updates(prev_move_board, post_move_board, sub_bb, add_bb);
+    threats.store(prev_move_board, post_move_board, sub_bb, add_bb);
 }
 
 void Network::apply_lazy_updates(const Accumulator& prev_acc, Accumulator& next_acc)
@@ -122,16 +343,17 @@ void Network::apply_lazy_updates(const Accumulator& prev_acc, Accumulator& next_
         return;
     }
 
-    compute_lazy_updates(next_acc);
-
-    next_acc.king_bucket.apply_lazy_updates(prev_acc.king_bucket, table, net);
+    Stats::increment(Stats::LAZY_UPDATES);
+    update.store(next_acc);
+    apply_update(prev_acc, next_acc);
+}
 
-    // The threat accumulator only reads `board` when a side needs a full recalculation, which happens
-    // exactly when the king crosses the FILE_D mirror. That same crossing always forces a king-bucket
-    // recalculation too (see KingBucketAccumulator::store_lazy_updates), which is the only path that
-    // populates king_bucket.board with post_move_board. So whenever threats actually use this board it
-    // holds the correct post-move position; otherwise it is unused.
-    next_acc.threats.apply_lazy_updates(prev_acc.threats, next_acc.king_bucket.board, net);
+void Network::apply_update(const Accumulator& prev_acc, Accumulator& next_acc)
+{
+    // The boards are owned by the GameState, which keeps them alive for as long as this ply is being searched
+    const BoardState& post_move_board = *next_acc.post_move_board;
+    next_acc.king_bucket.apply_lazy_updates(prev_acc.king_bucket, update.king_bucket, post_move_board, table, *net_);
+    next_acc.threats.apply_lazy_updates(prev_acc.threats, update.threats, post_move_board, threat_table, *net_);
 
     assert(next_acc.king_bucket.acc_is_valid);
     assert(next_acc.threats.acc_is_valid);
@@ -139,12 +361,210 @@ void Network::apply_lazy_updates(const Accumulator& prev_acc, Accumulator& next_
     next_acc.acc_is_valid = true;
 }
 
+bool FusedUpdate::fits(const AccumulatorUpdate& update) const
+{
+    return king_bucket_adds[WHITE].size + update.king_bucket.n_adds <= MAX_KING_BUCKET_ROWS
+        && king_bucket_subs[WHITE].size + update.king_bucket.n_subs <= MAX_KING_BUCKET_ROWS
+        && threat_adds[WHITE].size + update.threats.n_threat_adds <= MAX_THREAT_ROWS
+        && threat_subs[WHITE].size + update.threats.n_threat_subs <= MAX_THREAT_ROWS;
+}
+
+void FusedUpdate::merge(const AccumulatorUpdate& update, const network& net)
+{
+    assert(fits(update));
+
+    for (auto view : { WHITE, BLACK })
+    {
+        auto add_king_bucket_rows = [&](const auto& pairs, size_t n, auto& rows)
+        {
+            for (size_t i = 0; i < n; i++)
+            {
+                auto king = view == WHITE ? pairs[i].w_king : pairs[i].b_king;
+                rows.rows[rows.size++]
+                    = net.ft_weight[KingBucket::index(king, pairs[i].piece_sq, pairs[i].piece, view)].data();
+            }
+        };
+
+        auto add_threat_rows = [&](const auto& deltas, size_t n, auto& rows)
+        {
+            auto king = view == WHITE ? update.threats.w_king : update.threats.b_king;
+            for (size_t i = 0; i < n; i++)
+            {
+                const auto& d = deltas[i];
+                auto idx = view == WHITE
+                    ? Threats::get_threat_index<WHITE>(d.atk_piece, d.atk_sq, d.vic_piece, d.vic_sq, king)
+                    : Threats::get_threat_index<BLACK>(d.atk_piece, d.atk_sq, d.vic_piece, d.vic_sq, king);
+                rows.rows[rows.size++] = net.ft_threat_weight[idx].data();
+            }
+        };
+
+        add_king_bucket_rows(update.king_bucket.adds, update.king_bucket.n_adds, king_bucket_adds[view]);
+        add_king_bucket_rows(update.king_bucket.subs, update.king_bucket.n_subs, king_bucket_subs[view]);
+        add_threat_rows(update.threats.threat_adds, update.threats.n_threat_adds, threat_adds[view]);
+        add_threat_rows(update.threats.threat_subs, update.threats.n_threat_subs, threat_subs[view]);
+    }
+
+    plies++;
+}
+
+// Removes the rows present in both lists. The accumulators use wrapping integer arithmetic, so adding and subtracting
+// the same row is an exact no-op and the result is identical to applying each ply in turn.
+template <typename T, size_t N>
+static void cancel_rows(FusedUpdate::WeightRows<T, N>& adds, FusedUpdate::WeightRows<T, N>& subs)
+{
+    std::sort(adds.rows.begin(), adds.rows.begin() + adds.size);
+    std::sort(subs.rows.begin(), subs.rows.begin() + subs.size);
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t n_adds = 0;
+    size_t n_subs = 0;
+
+    while (i < adds.size && j < subs.size)
+    {
+        if (adds.rows[i] < subs.rows[j])
+        {
+            adds.rows[n_adds++] = adds.rows[i++];
+        }
+        else if (subs.rows[j] < adds.rows[i])
+        {
+            subs.rows[n_subs++] = subs.rows[j++];
+        }
+        else
+        {
+            i++;
+            j++;
+        }
+    }
+
+    while (i < adds.size)
+    {
+        adds.rows[n_adds++] = adds.rows[i++];
+    }
+
+    while (j < subs.size)
+    {
+        subs.rows[n_subs++] = subs.rows[j++];
+    }
+
+    adds.size = n_adds;
+    subs.size = n_subs;
+}
+
+void FusedUpdate::cancel()
+{
+    for (auto view : { WHITE, BLACK })
+    {
+        cancel_rows(king_bucket_adds[view], king_bucket_subs[view]);
+        cancel_rows(threat_adds[view], threat_subs[view]);
+    }
+}
+
+void FusedUpdate::clear()
+{
+    for (auto view : { WHITE, BLACK })
+    {
+        king_bucket_adds[view].size = 0;
+        king_bucket_subs[view].size = 0;
+        threat_adds[view].size = 0;
+        threat_subs[view].size = 0;
+    }
+
+    plies = 0;
+}
+
+void Network::apply_fused(const Accumulator& prev_acc, Accumulator& next_acc)
+{
+    fused.cancel();
+
+    Stats::increment(Stats::FUSED_THREAT_UPDATES);
+    Stats::increment(Stats::FUSED_THREAT_PLIES, fused.plies);
+    Stats::increment(Stats::FUSED_THREAT_ROWS_GATHERED,
+        fused.threat_adds[WHITE].size + fused.threat_subs[WHITE].size + fused.threat_adds[BLACK].size
+            + fused.threat_subs[BLACK].size);
+
+    for (auto view : { WHITE, BLACK })
+    {
+        NN::add_n_sub_n(next_acc.king_bucket.side[view], prev_acc.king_bucket.side[view],
+            fused.king_bucket_adds[view].rows.data(), fused.king_bucket_adds[view].size,
+            fused.king_bucket_subs[view].rows.data(), fused.king_bucket_subs[view].size);
+        NN::add_n_sub_n(next_acc.threats.side[view], prev_acc.threats.side[view], fused.threat_adds[view].rows.data(),
+            fused.threat_adds[view].size, fused.threat_subs[view].rows.data(), fused.threat_subs[view].size);
+    }
+
+    next_acc.king_bucket.acc_is_valid = true;
+    next_acc.threats.acc_is_valid = true;
+    next_acc.acc_is_valid = true;
+
+    fused.clear();
+}
+
+void Network::catch_up(Accumulator* valid_acc, Accumulator* acc)
+{
+    assert(valid_acc->acc_is_valid);
+
+    // The parent of acc is always materialized, because its other children will be evaluated next and need it. Only
+    // the plies before it are worth fusing.
+    if (acc - valid_acc > 2)
+    {
+        fuse_plies(valid_acc, acc - 1);
+        valid_acc = acc - 1;
+    }
+
+    for (auto* ply = valid_acc; ply < acc; ply++)
+    {
+        apply_lazy_updates(*ply, *(ply + 1));
+    }
+}
+
+void Network::fuse_plies(Accumulator* valid_acc, Accumulator* acc)
+{
+    // base is the accumulator the pending fused update applies on top of
+    const Accumulator* base = valid_acc;
+    fused.clear();
+
+    for (auto* ply = valid_acc + 1; ply <= acc; ply++)
+    {
+        Stats::increment(Stats::LAZY_UPDATES);
+        update.store(*ply);
+
+        const bool refresh = update.king_bucket.white_requires_recalculation
+            || update.king_bucket.black_requires_recalculation || update.threats.white_threats_requires_recalculation
+            || update.threats.black_threats_requires_recalculation;
+
+        // A refresh rebuilds one side from the refresh tables and needs the accumulator before it to be valid, as does
+        // a fused update that has grown too large to extend.
+        if ((refresh || !fused.fits(update)) && fused.plies > 0)
+        {
+            apply_fused(*base, *(ply - 1));
+            base = ply - 1;
+        }
+
+        if (refresh)
+        {
+            apply_update(*base, *ply);
+            base = ply;
+        }
+        else
+        {
+            fused.merge(update, *net_);
+        }
+    }
+
+    if (fused.plies > 0)
+    {
+        apply_fused(*base, *acc);
+    }
+}
+
 int calculate_output_bucket(int pieces)
 {
     return (pieces - 2) / (32 / OUTPUT_BUCKETS);
 }
 
-Score Network::eval(const BoardState& board, const Accumulator& acc)
+// Runs the feature transformer activation and the L1 affine transform for a position, and returns its output bucket
+int eval_l1_affine(const BoardState& board, const Accumulator& acc, const network& net,
+    std::array<int32_t, L1_SIZE>& l1_output)
 {
     auto output_bucket = calculate_output_bucket(std::popcount(board.get_pieces_bb()));
     auto stm = board.stm;
@@ -155,12 +575,33 @@ Score Network::eval(const BoardState& board, const Accumulator& acc)
     NN::Features::FT_activation(acc.king_bucket.side[stm], acc.king_bucket.side[!stm], acc.threats.side[stm],
         acc.threats.side[!stm], ft_activation, sparse_ft_nibbles, sparse_nibbles_size);
     assert(std::all_of(ft_activation.begin(), ft_activation.end(), [](auto x) { return x <= 127; }));
+    Stats::increment(Stats::NETWORK_EVALS);
+    Stats::record(Stats::L1_NNZ_BLOCKS, sparse_nibbles_size);
 
-    alignas(64) std::array<float, L1_SIZE * 2> l1_activation;
-    NN::Features::L1_activation(ft_activation, net.l1_weight[output_bucket], net.l1_bias[output_bucket],
-        sparse_ft_nibbles, sparse_nibbles_size, l1_activation);
+    NN::Features::L1_affine(ft_activation, net.l1_weight[output_bucket], net.l1_bias[output_bucket],
+        sparse_ft_nibbles, sparse_nibbles_size, l1_output);
+
+    return output_bucket;
+}
+
+// Runs the feature transformer activation and L1 for a position, and returns its output bucket
+int eval_l1(const BoardState& board, const Accumulator& acc, const network& net,
+    std::array<float, L1_SIZE * 2>& l1_activation)
+{
+    alignas(64) std::array<int32_t, L1_SIZE> l1_output;
+    auto output_bucket = eval_l1_affine(board, acc, net, l1_output);
+
+    NN::Features::L1_activation(l1_output, l1_activation);
     assert(std::all_of(l1_activation.begin(), l1_activation.end(), [](auto x) { return 0 <= x && x <= 1; }));
 
+    return output_bucket;
+}
+
+Score eval_with(const BoardState& board, const Accumulator& acc, const network& net)
+{
+    alignas(64) std::array<float, L1_SIZE * 2> l1_activation;
+    auto output_bucket = eval_l1(board, acc, net, l1_activation);
+
     alignas(64) std::array<float, L2_SIZE> l2_activation;
     NN::Features::L2_activation(l1_activation, net.l2_weight[output_bucket], net.l2_bias[output_bucket], l2_activation);
     assert(std::all_of(l2_activation.begin(), l2_activation.end(), [](auto x) { return 0 <= x && x <= 1; }));
@@ -171,11 +612,160 @@ Score Network::eval(const BoardState& board, const Accumulator& acc)
     return output * SCALE_FACTOR;
 }
 
+// Like eval_with, but runs L2 and L3 on the quantized weights in integer arithmetic
+Score eval_int_with(const BoardState& board, const Accumulator& acc, const network& net)
+{
+    alignas(64) std::array<int32_t, L1_SIZE> l1_output;
+    auto output_bucket = eval_l1_affine(board, acc, net, l1_output);
+
+    alignas(64) std::array<int16_t, L1_SIZE * 2> l1_activation;
+    NN::Features::L1_activation_int(l1_output, l1_activation);
+
+    alignas(64) std::array<int32_t, L2_SIZE> l2_activation;
+    NN::Features::L2_activation_int(
+        l1_activation, net.l2_weight_int[output_bucket], net.l2_bias_int[output_bucket], l2_activation);
+
+    const auto output = NN::Features::L3_activation_int(
+        l2_activation, net.l3_weight_int[output_bucket], net.l3_bias_int[output_bucket]);
+
+    return static_cast<float>(output) * (SCALE_FACTOR / (L2_INT_ONE * L3_SCALE));
+}
+
+// Positions are evaluated in chunks. Within a chunk they are ordered by output bucket, so each bucket's weights stay in
+// cache for a run of positions, and L2 is computed L2_BATCH_SIZE positions at a time.
+void eval_batch_with(std::span<const BoardState* const> boards, std::span<const Accumulator* const> accs,
+    std::span<Score> scores, const network& net, bool integer)
+{
+    assert(boards.size() == accs.size() && boards.size() == scores.size());
+
+    if (integer)
+    {
+        for (size_t i = 0; i < boards.size(); i++)
+        {
+            scores[i] = eval_int_with(*boards[i], *accs[i], net);
+        }
+        return;
+    }
+
+    constexpr size_t chunk_size = 64;
+    alignas(64) std::array<std::array<float, L1_SIZE * 2>, chunk_size> l1_activation;
+    alignas(64) std::array<std::array<float, L2_SIZE>, chunk_size> l2_activation;
+    std::array<int, chunk_size> buckets;
+    std::array<size_t, chunk_size> order;
+
+    for (size_t begin = 0; begin < boards.size(); begin += chunk_size)
+    {
+        const size_t n = std::min(chunk_size, boards.size() - begin);
+
+        // counting sort the positions by output bucket
+        std::array<size_t, OUTPUT_BUCKETS + 1> bucket_start = {};
+        for (size_t i = 0; i < n; i++)
+        {
+            buckets[i] = calculate_output_bucket(std::popcount(boards[begin + i]->get_pieces_bb()));
+            bucket_start[buckets[i] + 1]++;
+        }
+
+        for (size_t bucket = 0; bucket < OUTPUT_BUCKETS; bucket++)
+        {
+            bucket_start[bucket + 1] += bucket_start[bucket];
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            order[bucket_start[buckets[i]]++] = i;
+        }
+
+        for (size_t k = 0; k < n; k++)
+        {
+            auto i = order[k];
+            eval_l1(*boards[begin + i], *accs[begin + i], net, l1_activation[i]);
+        }
+
+        for (size_t k = 0; k < n;)
+        {
+            const auto bucket = buckets[order[k]];
+            size_t run_end = k;
+            while (run_end < n && buckets[order[run_end]] == bucket)
+            {
+                run_end++;
+            }
+
+            for (; k + NN::Features::L2_BATCH_SIZE <= run_end; k += NN::Features::L2_BATCH_SIZE)
+            {
+                std::array<const std::array<float, L1_SIZE * 2>*, NN::Features::L2_BATCH_SIZE> inputs;
+                std::array<std::array<float, L2_SIZE>*, NN::Features::L2_BATCH_SIZE> outputs;
+                for (size_t b = 0; b < NN::Features::L2_BATCH_SIZE; b++)
+                {
+                    inputs[b] = &l1_activation[order[k + b]];
+                    outputs[b] = &l2_activation[order[k + b]];
+                }
+                NN::Features::L2_activation_batch(inputs, net.l2_weight[bucket], net.l2_bias[bucket], outputs);
+            }
+
+            for (; k < run_end; k++)
+            {
+                NN::Features::L2_activation(
+                    l1_activation[order[k]], net.l2_weight[bucket], net.l2_bias[bucket], l2_activation[order[k]]);
+            }
+        }
+
+        for (size_t i = 0; i < n; i++)
+        {
+            float output = net.l3_bias[buckets[i]];
+            NN::Features::L3_activation(l2_activation[i], net.l3_weight[buckets[i]], output);
+            scores[begin + i] = output * SCALE_FACTOR;
+        }
+    }
+}
+
+Score Network::eval(const BoardState& board, const Accumulator& acc) const
+{
+    return eval(board, acc, integer_inference_);
+}
+
+Score Network::eval(const BoardState& board, const Accumulator& acc, bool integer) const
+{
+    return integer ? eval_int_with(board, acc, *net_) : eval_with(board, acc, *net_);
+}
+
 Score Network::slow_eval(const BoardState& board)
 {
+    const network& net = get_network(0);
     Accumulator acc;
-    acc.recalculate(board);
-    return eval(board, acc);
+    acc.recalculate(board, net);
+    return integer_inference ? eval_int_with(board, acc, net) : eval_with(board, acc, net);
+}
+
+void Network::eval_batch(
+    std::span<const BoardState* const> boards, std::span<const Accumulator* const> accs, std::span<Score> scores) const
+{
+    eval_batch_with(boards, accs, scores, *net_, integer_inference_);
+}
+
+void Network::slow_eval_batch(std::span<const BoardState> boards, std::span<Score> scores)
+{
+    assert(boards.size() == scores.size());
+
+    constexpr size_t chunk_size = 256;
+    const network& net = get_network(0);
+    std::vector<Accumulator> accs(std::min(chunk_size, boards.size()));
+    std::vector<const BoardState*> board_ptrs(accs.size());
+    std::vector<const Accumulator*> acc_ptrs(accs.size());
+
+    for (size_t begin = 0; begin < boards.size(); begin += chunk_size)
+    {
+        const size_t n = std::min(chunk_size, boards.size() - begin);
+
+        for (size_t i = 0; i < n; i++)
+        {
+            accs[i].recalculate(boards[begin + i], net);
+            board_ptrs[i] = &boards[begin + i];
+            acc_ptrs[i] = &accs[i];
+        }
+
+        eval_batch_with(
+            { board_ptrs.data(), n }, { acc_ptrs.data(), n }, scores.subspan(begin, n), net, integer_inference);
+    }
 }
 
 }
\ No newline at end of file
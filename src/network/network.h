@@ -5,13 +5,50 @@
 #include "network/accumulator/threat.h"
 #include "search/score.h"
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
 class BoardState;
 
 namespace NN
 {
 
+struct network;
+struct LoadedNetwork;
+
+// Returns the copy of the network weights on the NUMA node that thread_index is bound to
+const network& get_network(size_t thread_index);
+
+// Memory maps a network preprocessed by tools/verbatim.cpp and uses it for subsequent searches, or reverts to the
+// embedded network if path is "<internal>". Returns false if the file can't be used. Must not be called during search.
+// The previous network stays loaded until every search thread has picked up the new one.
+bool load_network(std::string_view path, bool print);
+
+// Returns a hash of the weights of the network used by new searches, so that data derived from its evals can be
+// matched to it
+uint64_t network_hash();
+
+// Sets the size in KiB of each search thread's eval cache, which takes effect from the next search. A size of zero
+// disables the cache. Must not be called during search.
+void set_eval_cache_size(size_t size_kb);
+
+// Selects whether L2 and L3 run in float, or in integer arithmetic on the quantized weights produced by
+// tools/verbatim.cpp. Takes effect from the next search. Must not be called during search.
+void set_integer_inference(bool enabled);
+
+// Returns the output bucket used to evaluate a position with this many pieces on the board
+int calculate_output_bucket(int pieces);
+
 // The main accumulator, composed of independently-updatable sub-accumulators for each input type.
-// king_bucket stores bias + king-bucketed; threats is updated separately.
+// king_bucket stores bias + king-bucketed; threats is updated separately. One of these is kept per ply, so it holds
+// only the accumulator values and the few pointers needed to compute its lazy update later. The input changes
+// themselves are computed into AccumulatorUpdate when the update is applied.
 struct Accumulator
 {
     KingBucket::KingBucketAccumulator king_bucket;
@@ -27,33 +64,109 @@ struct Accumulator
         return king_bucket == rhs.king_bucket && threats == rhs.threats;
     }
 
-    void recalculate(const BoardState& board);
+    void recalculate(const BoardState& board, const network& net);
 
     bool acc_is_valid = false;
 };
 
+// The input changes made by a single move, shared by all plies of a thread's accumulator stack
+struct AccumulatorUpdate
+{
+    KingBucket::KingBucketUpdate king_bucket;
+    Threats::ThreatUpdate threats;
+
+    // computes the changes made by the move acc was marked with in mark_lazy_update
+    void store(const Accumulator& acc);
+};
+
+// The merged input changes of several consecutive plies, none of which refresh an accumulator. Each list holds the
+// weight rows to add or subtract for one perspective, and a feature added on one ply and removed on another cancels
+// out before the accumulator is touched.
+struct FusedUpdate
+{
+    template <typename T, size_t N>
+    struct WeightRows
+    {
+        std::array<const T*, N> rows;
+        size_t size = 0;
+    };
+
+    static constexpr size_t MAX_KING_BUCKET_ROWS = 32;
+    static constexpr size_t MAX_THREAT_ROWS = 2 * Threats::MAX_THREAT_DELTAS;
+
+    std::array<WeightRows<int16_t, MAX_KING_BUCKET_ROWS>, N_SIDES> king_bucket_adds;
+    std::array<WeightRows<int16_t, MAX_KING_BUCKET_ROWS>, N_SIDES> king_bucket_subs;
+    std::array<WeightRows<int8_t, MAX_THREAT_ROWS>, N_SIDES> threat_adds;
+    std::array<WeightRows<int8_t, MAX_THREAT_ROWS>, N_SIDES> threat_subs;
+    size_t plies = 0;
+
+    // returns true if the update can be merged without overflowing any list
+    bool fits(const AccumulatorUpdate& update) const;
+    void merge(const AccumulatorUpdate& update, const network& net);
+    void cancel();
+    void clear();
+};
+
 class Network
 {
 public:
+    explicit Network(size_t thread_index);
+
     // called at the root of search
     void reset_new_search(const BoardState& board, Accumulator& acc);
 
     // return true if the incrementally updated accumulator is correct
-    static bool verify(const BoardState& board, const Accumulator& acc);
+    bool verify(const BoardState& board, const Accumulator& acc) const;
 
     // calculates starting from the first hidden layer and skips input -> hidden
-    static Score eval(const BoardState& board, const Accumulator& acc);
+    Score eval(const BoardState& board, const Accumulator& acc) const;
+
+    // as above, but with the choice of float or integer L2 and L3 made by the caller
+    Score eval(const BoardState& board, const Accumulator& acc, bool integer) const;
 
     // does a full from scratch recalculation
     static Score slow_eval(const BoardState& board);
 
+    // Evaluates many independent positions, writing the score of boards[i] with accumulator accs[i] to scores[i].
+    // Gives the same scores as eval(), but groups the positions by output bucket and shares L2 weight loads between
+    // them.
+    void eval_batch(std::span<const BoardState* const> boards, std::span<const Accumulator* const> accs,
+        std::span<Score> scores) const;
+
+    // does a full from scratch recalculation of each board, then evaluates them as a batch
+    static void slow_eval_batch(std::span<const BoardState> boards, std::span<Score> scores);
+
     void mark_lazy_update(
         const BoardState& prev_move_board, const BoardState& post_move_board, Accumulator& acc, Move move);
 
     void apply_lazy_updates(const Accumulator& prev_acc, Accumulator& next_acc);
 
+    // Returns the result of eval() for the position with this key, if it is in the eval cache
+    std::optional<Score> probe_eval_cache(uint64_t key);
+    void store_eval_cache(uint64_t key, Score eval);
+
+    // Brings acc up to date, where valid_acc is the closest valid accumulator below it on the same stack. Runs of plies
+    // without a refresh are merged and applied in one pass, leaving the accumulators in between invalid.
+    void catch_up(Accumulator* valid_acc, Accumulator* acc);
+
 private:
+    void fuse_plies(Accumulator* valid_acc, Accumulator* acc);
+    void apply_update(const Accumulator& prev_acc, Accumulator& next_acc);
+    void apply_fused(const Accumulator& prev_acc, Accumulator& next_acc);
+
+    size_t thread_index_;
+    std::shared_ptr<const LoadedNetwork> loaded_net_;
+    const network* net_;
+    bool integer_inference_;
     KingBucket::AccumulatorTable table;
+    Threats::ThreatRefreshTable threat_table;
+    AccumulatorUpdate update;
+    FusedUpdate fused;
+
+    // A small direct mapped cache of eval() results, so that positions revisited after their TT entry has been
+    // overwritten don't need an accumulator catch-up and inference again. Each entry packs the upper 48 bits of the key
+    // with the 16 bit eval.
+    std::vector<uint64_t> eval_cache;
 };
 
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "network/stats.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+
+namespace NN::Stats
+{
+
+#ifdef NETWORK_STATS
+
+namespace
+{
+
+std::array<std::atomic<uint64_t>, N_COUNTERS> counters {};
+std::array<std::array<std::atomic<uint64_t>, MAX_HISTOGRAM_VALUE + 1>, N_HISTOGRAMS> histograms {};
+
+uint64_t get(Counter counter)
+{
+    return counters[counter].load(std::memory_order_relaxed);
+}
+
+double ratio(Counter numerator, Counter denominator)
+{
+    auto count = get(denominator);
+    return count == 0 ? 0.0 : static_cast<double>(get(numerator)) / count;
+}
+
+// Prints the mean and a few percentiles of a histogram
+void print_histogram(std::ostream& os, std::string_view name, Histogram histogram)
+{
+    std::array<uint64_t, MAX_HISTOGRAM_VALUE + 1> counts;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    for (size_t value = 0; value <= MAX_HISTOGRAM_VALUE; value++)
+    {
+        counts[value] = histograms[histogram][value].load(std::memory_order_relaxed);
+        total += counts[value];
+        sum += counts[value] * value;
+    }
+
+    os << name << ": samples " << total;
+    if (total == 0)
+    {
+        os << "\n";
+        return;
+    }
+
+    os << " mean " << static_cast<double>(sum) / total;
+    uint64_t seen = 0;
+    size_t value = 0;
+    for (auto [label, percentile] : { std::pair { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 } })
+    {
+        while (seen + counts[value] < percentile * total)
+        {
+            seen += counts[value++];
+        }
+        os << " " << label << " " << value;
+    }
+
+    size_t max = MAX_HISTOGRAM_VALUE;
+    while (counts[max] == 0)
+    {
+        max--;
+    }
+    os << " max " << max << (max == MAX_HISTOGRAM_VALUE ? "+" : "") << "\n";
+}
+
+}
+
+void increment(Counter counter, uint64_t amount)
+{
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+void record(Histogram histogram, size_t value)
+{
+    histograms[histogram][std::min(value, MAX_HISTOGRAM_VALUE)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void reset()
+{
+    for (auto& counter : counters)
+    {
+        counter.store(0, std::memory_order_relaxed);
+    }
+
+    for (auto& histogram : histograms)
+    {
+        for (auto& count : histogram)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+void print(std::ostream& os)
+{
+    os << std::fixed << std::setprecision(2);
+    os << "network evals: " << get(NETWORK_EVALS) << " lazy updates per eval " << ratio(LAZY_UPDATES, NETWORK_EVALS)
+       << "\n";
+    os << "king bucket refreshes: " << get(KING_BUCKET_REFRESHES) << " per eval "
+       << ratio(KING_BUCKET_REFRESHES, NETWORK_EVALS) << " finny hit rate "
+       << 100 * ratio(FINNY_HITS, KING_BUCKET_REFRESHES) << "% rows per refresh "
+       << ratio(FINNY_ROWS, KING_BUCKET_REFRESHES) << " (from scratch "
+       << ratio(FINNY_SCRATCH_ROWS, KING_BUCKET_REFRESHES) << ")\n";
+    os << "threat refreshes: " << get(THREAT_REFRESHES) << " per eval " << ratio(THREAT_REFRESHES, NETWORK_EVALS)
+       << "\n";
+    os << "threat updates: " << get(THREAT_UPDATES) << " rows gathered per update "
+       << ratio(THREAT_ROWS_GATHERED, THREAT_UPDATES) << "\n";
+    os << "fused threat updates: " << get(FUSED_THREAT_UPDATES) << " plies per update "
+       << ratio(FUSED_THREAT_PLIES, FUSED_THREAT_UPDATES) << " rows gathered per update "
+       << ratio(FUSED_THREAT_ROWS_GATHERED, FUSED_THREAT_UPDATES) << " per ply "
+       << ratio(FUSED_THREAT_ROWS_GATHERED, FUSED_THREAT_PLIES) << "\n";
+    const auto all_rows = get(THREAT_ROWS_GATHERED) + get(FUSED_THREAT_ROWS_GATHERED);
+    const auto all_plies = get(THREAT_UPDATES) + get(FUSED_THREAT_PLIES);
+    os << "threat rows gathered per ply, including fused: "
+       << (all_plies == 0 ? 0.0 : static_cast<double>(all_rows) / all_plies) << "\n";
+    print_histogram(os, "threat deltas per move", THREAT_DELTAS_PER_MOVE);
+    print_histogram(os, "catch-up distance", CATCH_UP_DISTANCE);
+    print_histogram(os, "l1 non-zero blocks", L1_NNZ_BLOCKS);
+    os << "eval cache: probes " << get(EVAL_CACHE_PROBES) << " hit rate "
+       << 100 * ratio(EVAL_CACHE_HITS, EVAL_CACHE_PROBES) << "%\n";
+    os << std::defaultfloat;
+}
+
+#endif
+
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Counters describing how the accumulators are updated and how expensive inference is during search. They are only
+// compiled in when NETWORK_STATS is defined (make EXTRA_CXXFLAGS=-DNETWORK_STATS), and otherwise the calls below
+// compile away to nothing.
+namespace NN::Stats
+{
+
+enum Counter : size_t
+{
+    NETWORK_EVALS,
+    LAZY_UPDATES,
+    KING_BUCKET_REFRESHES,
+    FINNY_HITS,
+    FINNY_ROWS,
+    FINNY_SCRATCH_ROWS,
+    THREAT_REFRESHES,
+    THREAT_UPDATES,
+    THREAT_ROWS_GATHERED,
+    // multi-ply catch-ups merged into a single pass, and the threat rows left to gather once deltas cancel
+    FUSED_THREAT_UPDATES,
+    FUSED_THREAT_PLIES,
+    FUSED_THREAT_ROWS_GATHERED,
+    EVAL_CACHE_PROBES,
+    EVAL_CACHE_HITS,
+    N_COUNTERS
+};
+
+// Distributions of small non-negative values. Values above MAX_HISTOGRAM_VALUE are recorded as MAX_HISTOGRAM_VALUE.
+enum Histogram : size_t
+{
+    THREAT_DELTAS_PER_MOVE,
+    CATCH_UP_DISTANCE,
+    L1_NNZ_BLOCKS,
+    N_HISTOGRAMS
+};
+
+constexpr size_t MAX_HISTOGRAM_VALUE = 255;
+
+#ifdef NETWORK_STATS
+
+constexpr bool enabled = true;
+
+void increment(Counter counter, uint64_t amount = 1);
+void record(Histogram histogram, size_t value);
+void reset();
+
+// Prints a summary of the counters since the last reset
+void print(std::ostream& os);
+
+#else
+
+constexpr bool enabled = false;
+
+inline void increment(Counter, uint64_t = 1) { }
+inline void record(Histogram, size_t) { }
+inline void reset() { }
+inline void print(std::ostream&) { }
+
+#endif
+
+}
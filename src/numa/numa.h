@@ -25,14 +25,16 @@ public:
     PerNumaAllocation(PerNumaAllocation&&) = delete;
     PerNumaAllocation& operator=(PerNumaAllocation&&) = delete;
 
-    PerNumaAllocation()
+    // Each instance is constructed from args, so passing an existing T gives every node its own copy of it.
+    template <typename... Args>
+    explicit PerNumaAllocation(const Args&... args)
     {
         auto numa_count = get_numa_node_count();
         while (data_.size() < numa_count)
         {
             size_t node = data_.size();
             void* mem = numa_alloc_on_node(sizeof(T), node);
-            T* ptr = new (mem) T();
+            T* ptr = new (mem) T(args...);
             data_.push_back(ptr);
         }
     }
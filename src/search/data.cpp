@@ -4,6 +4,7 @@
 #include "chessboard/board_state.h"
 #include "movegen/move.h"
 #include "movegen/movegen.h"
+#include "network/network.h"
 #include "search/score.h"
 #include "search/transposition/table.h"
 #include "spsa/tuneable.h"
@@ -17,8 +18,10 @@
 #include <iterator>
 #include <mutex>
 #include <numeric>
+#include <optional>
 #include <ranges>
 #include <ratio>
+#include <string>
 #include <unordered_map>
 
 namespace
@@ -55,6 +58,7 @@ NN::Accumulator* AccumulatorStack::root()
 SearchLocalState::SearchLocalState(int thread_id_, SharedHistory* corr_hist_)
     : thread_id(thread_id_)
     , shared_hist(corr_hist_)
+    , net(thread_id_)
 {
 }
 
@@ -81,12 +85,10 @@ void SearchLocalState::reset_new_search()
     // We don't reset the history tables because it gains elo to perserve them between turns
     search_stack = default_search_stack;
     acc_stack = default_acc_stack;
-    tb_hits = 0;
-    nodes = 0;
+    reset_shared_state();
     sel_depth = 0;
     curr_depth = 0;
     curr_multi_pv = 0;
-    thread_wants_to_stop = false;
     aborting_search = false;
     root_move_blacklist = {};
     root_move_whitelist = {};
@@ -99,6 +101,13 @@ void SearchLocalState::reset_new_search()
     std::ranges::copy(moves, std::back_inserter(root_moves));
 }
 
+void SearchLocalState::reset_shared_state()
+{
+    tb_hits = 0;
+    nodes = 0;
+    thread_wants_to_stop = false;
+}
+
 int SearchLocalState::get_quiet_search_history(const SearchStackState* ss, Move move)
 {
     int total = 0;
@@ -193,10 +202,12 @@ SearchSharedState::SearchSharedState(UCI::UciOutput& uci)
 void SearchSharedState::reset_new_search()
 {
     search_timer.reset();
+    limits_timer.reset();
 }
 
 void SearchSharedState::reset_new_game()
 {
+    finish_hash_resize();
     transposition_table.clear(get_threads_setting());
     shared_hist_ = std::make_unique<PerNumaAllocation<SharedHistory>>();
     reset_new_search();
@@ -214,18 +225,33 @@ void SearchSharedState::set_threads(int threads)
 
 void SearchSharedState::set_hash(int hash_size_mb, bool print)
 {
-    auto start = std::chrono::steady_clock::now();
-    transposition_table.set_size(hash_size_mb, get_threads_setting());
-    auto end = std::chrono::steady_clock::now();
+    hash_setting = hash_size_mb;
+    print_hash_resize_time_ = print;
+    transposition_table.start_resize(hash_size_mb, get_threads_setting());
+}
 
-    if (print && uci_handler.output_level > UCI::OutputLevel::None)
+void SearchSharedState::finish_hash_resize()
+{
+    const auto duration = transposition_table.finish_resize();
+    if (duration && print_hash_resize_time_ && uci_handler.output_level > UCI::OutputLevel::None)
     {
-        auto duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
         std::lock_guard io { UCI::output_mutex };
-        std::cout << "info string hash init time " << duration_ms << "ms" << std::endl;
+        std::cout << "info string hash init time " << duration->count() << "ms" << std::endl;
     }
 }
 
+std::optional<std::string> SearchSharedState::save_hash(const std::string& path, int halfmove)
+{
+    finish_hash_resize();
+    return transposition_table.save(path, halfmove, NN::network_hash());
+}
+
+std::optional<std::string> SearchSharedState::load_hash(const std::string& path, int halfmove)
+{
+    finish_hash_resize();
+    return transposition_table.load(path, halfmove, NN::network_hash(), get_threads_setting());
+}
+
 int64_t SearchSharedState::tb_hits() const
 {
     return std::accumulate(search_local_states_.begin(), search_local_states_.end(), (int64_t)0,
@@ -248,6 +274,11 @@ int SearchSharedState::get_multi_pv_setting() const
     return multi_pv_setting;
 }
 
+int SearchSharedState::get_hash_setting() const
+{
+    return hash_setting;
+}
+
 void SearchSharedState::report_thread_wants_to_stop()
 {
     // If at least half the threads (rounded up) want to stop, we abort
@@ -268,6 +299,11 @@ void SearchSharedState::report_thread_wants_to_stop()
     }
 }
 
+bool SearchSharedState::time_limits_apply() const
+{
+    return limits.time && !pondering;
+}
+
 SearchInfoData SearchSharedState::build_search_info(int depth, int sel_depth, Score score, int multi_pv,
     const StaticVector<Move, MAX_RECURSION>& pv, SearchResultType type) const
 {
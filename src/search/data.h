@@ -23,6 +23,8 @@
 #include <memory>
 #include <mutex>
 #include <new>
+#include <optional>
+#include <string>
 #include <utility>
 #include <vector>
 #include <version>
@@ -125,6 +127,10 @@ public:
     bool should_skip_root_move(Move move);
     void reset_new_search();
 
+    // Resets the state that other threads read while searching. Called for every thread before any of them start
+    // searching, so no thread sees values left over from the previous search.
+    void reset_shared_state();
+
     int get_quiet_search_history(const SearchStackState* ss, Move move);
     int get_quiet_order_history(const SearchStackState* ss, Move move);
     int get_loud_history(const SearchStackState* ss, Move move);
@@ -203,9 +209,23 @@ public:
     void reset_new_game();
     void set_multi_pv(int multi_pv);
     void set_threads(int threads);
+
+    // Resizes the transposition table in the background, keeping its entries. The resize is finished by the first
+    // search, new game, or hash save or load after it, or by finish_hash_resize.
     void set_hash(int hash_size_mb, bool print = false);
+
+    // Saves or loads the transposition table, tagged with the current network. halfmove is that of the root position,
+    // which entry ages are relative to. Returns a description of the error on failure.
+    std::optional<std::string> save_hash(const std::string& path, int halfmove);
+    std::optional<std::string> load_hash(const std::string& path, int halfmove);
+
     SearchInfoData get_best_root_move();
 
+    // Below functions are thread-safe, and block until a hash resize is finished
+    // ------------------------------------
+
+    void finish_hash_resize();
+
     // Below functions are thread-safe and non-blocking
     // ------------------------------------
 
@@ -213,15 +233,24 @@ public:
     int64_t nodes() const;
     int get_threads_setting() const;
     int get_multi_pv_setting() const;
+    int get_hash_setting() const;
     SearchInfoData build_search_info(int depth, int sel_depth, Score score, int multi_pv,
         const StaticVector<Move, MAX_RECURSION>& pv, SearchResultType type) const;
 
     void report_thread_wants_to_stop();
+    bool time_limits_apply() const;
     SharedHistory* get_shared_hist(size_t thread_index);
 
     bool chess_960 {};
     SearchLimits limits;
     Timer search_timer;
+
+    // The time limits are measured from this timer rather than search_timer, so that on ponderhit the limits apply from
+    // the ponderhit rather than the start of the search
+    Timer limits_timer;
+
+    // While pondering the time limits are ignored and the best move is held back until ponderhit or stop
+    AtomicRelAcq<bool> pondering = false;
     UCI::UciOutput& uci_handler;
 
     AtomicRelaxed<bool> stop_searching = false;
@@ -233,6 +262,8 @@ private:
     mutable std::recursive_mutex lock_;
     int multi_pv_setting {};
     int threads_setting {};
+    int hash_setting {};
+    bool print_hash_resize_time_ = false;
 
     // Idea from Stockfish: sharing correction history between threads has great SMP scaling. We need to avoid sharing
     // across NUMA nodes though, as the latency penalty is too high.
@@ -12,4 +12,7 @@ public:
     std::optional<int> depth;
     std::optional<int> mate;
     std::optional<uint64_t> nodes;
+
+    // Search in infinite mode until a ponderhit, after which the time limits apply
+    bool ponder = false;
 };
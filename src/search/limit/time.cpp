@@ -2,6 +2,7 @@
 
 #include "spsa/tuneable.h"
 
+#include <algorithm>
 #include <chrono>
 #include <compare>
 #include <ratio>
@@ -14,7 +15,7 @@ Timer::Timer()
 std::chrono::nanoseconds Timer::elapsed() const
 {
     auto now = std::chrono::high_resolution_clock::now();
-    return (now - begin_);
+    return (now - begin_.load(std::memory_order_relaxed));
 }
 
 void Timer::reset()
@@ -41,8 +42,7 @@ bool SearchTimeManager::should_continue_search(const Timer& timer, float factor)
     return (elapsed_ms < soft_limit_ * factor * soft_tm && elapsed_ms < hard_limit_);
 }
 
-bool SearchTimeManager::should_abort_search(const Timer& timer) const
+chess_clock_t::duration SearchTimeManager::abort_time() const
 {
-    auto elapsed_ms = timer.elapsed();
-    return (elapsed_ms >= soft_limit_ || elapsed_ms >= hard_limit_);
+    return std::min(soft_limit_, hard_limit_);
 }
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "utility/atomic.h"
+
 #include <chrono>
 
 using chess_clock_t = std::chrono::high_resolution_clock;
@@ -13,7 +15,8 @@ public:
     void reset();
 
 private:
-    chess_clock_t::time_point begin_;
+    // Atomic so the timer can be reset while other threads are reading it, e.g on ponderhit
+    AtomicRelaxed<chess_clock_t::time_point> begin_;
 };
 
 class SearchTimeManager
@@ -22,7 +25,9 @@ public:
     SearchTimeManager(chess_clock_t::duration soft_limit, chess_clock_t::duration hard_limit);
 
     bool should_continue_search(const Timer& timer, float factor) const;
-    bool should_abort_search(const Timer& timer) const;
+
+    // The time after which the search must be aborted, even mid-iteration
+    chess_clock_t::duration abort_time() const;
 
 private:
     // The amount of time we have allocated to this turn. If the position is indecisive the search might extend this
@@ -18,6 +18,7 @@
 #include "search/static_exchange_evaluation.h"
 #include "search/syzygy.h"
 #include "search/transposition/entry.h"
+#include "search/transposition/stats.h"
 #include "search/transposition/table.h"
 #include "search/zobrist.h"
 #include "spsa/tuneable.h"
@@ -147,8 +148,8 @@ void iterative_deepening(GameState& position, SearchLocalState& local, SearchSha
                 search_time_usage_scale = node_factor * stability_factor * score_stability_factor;
             }
 
-            if (shared.limits.time
-                && !shared.limits.time->should_continue_search(shared.search_timer, search_time_usage_scale))
+            if (shared.time_limits_apply()
+                && !shared.limits.time->should_continue_search(shared.limits_timer, search_time_usage_scale))
             {
                 local.thread_wants_to_stop = true;
                 shared.report_thread_wants_to_stop();
@@ -258,30 +259,25 @@ bool should_abort_search(SearchLocalState& local, const SearchSharedState& share
         return true;
     }
 
-    // Avoid checking the limits too often
-    if (local.limit_check_counter > 0)
-    {
-        local.limit_check_counter--;
-        return false;
-    }
-
     // No matter what, we always complete a depth 1 search.
     if (local.curr_depth <= 1)
     {
         return false;
     }
 
-    // A signal that we recieved a UCI stop command, or the threads voted to stop searching
+    // A signal that we recieved a UCI stop command, the threads voted to stop searching, or the watchdog found we ran
+    // out of time. This is a single relaxed load so we can afford to check it every node.
     if (shared.stop_searching)
     {
         local.aborting_search = true;
         return true;
     }
 
-    if (shared.limits.time && shared.limits.time->should_abort_search(shared.search_timer))
+    // Avoid checking the node limit too often
+    if (local.limit_check_counter > 0)
     {
-        local.aborting_search = true;
-        return true;
+        local.limit_check_counter--;
+        return false;
     }
 
     if (shared.limits.nodes)
@@ -445,13 +441,24 @@ std::optional<Score> probe_egtb(const GameState& position, const int distance_fr
     return std::nullopt;
 }
 
-std::tuple<Transposition::Entry*, Score, int, SearchResultType, Move, Score> probe_tt(
+std::tuple<std::optional<Transposition::Entry>, Score, int, SearchResultType, Move, Score> probe_tt(
     SearchSharedState& shared, const GameState& position, const int distance_from_root)
 {
     // copy the values out of the table that we want, to avoid race conditions
     const auto adjusted_key = Zobrist::get_fifty_move_adj_key(position.board());
-    auto* tt_entry
+    const auto tt_entry
         = shared.transposition_table.get_entry(adjusted_key, distance_from_root, position.board().half_turn_count);
+    if (tt_entry)
+    {
+        if constexpr (Transposition::Stats::enabled)
+        {
+            if (tt_entry->move != Move::Uninitialized && !is_legal(position.board(), tt_entry->move))
+            {
+                Transposition::Stats::increment(Transposition::Stats::ALIASED_HITS);
+            }
+        }
+    }
+
     const auto tt_score
         = tt_entry ? Transposition::convert_from_tt_score(tt_entry->score, distance_from_root) : SCORE_UNDEFINED;
     const auto tt_depth = tt_entry ? tt_entry->depth : 0;
@@ -473,6 +480,7 @@ std::optional<Score> tt_cutoff_node(const GameState& position, const Score tt_sc
     if (tt_cutoff == SearchResultType::EXACT || (tt_cutoff == SearchResultType::LOWER_BOUND && tt_score >= beta)
         || (tt_cutoff == SearchResultType::UPPER_BOUND && tt_score <= alpha))
     {
+        Transposition::Stats::increment(Transposition::Stats::CUTOFFS);
         return tt_score;
     }
 
@@ -723,7 +731,7 @@ Score search_move(GameState& position, SearchStackState* ss, NN::Accumulator* ac
 // { raw, adjusted }
 template <bool is_qsearch>
 std::tuple<Score, Score> get_search_eval(const GameState& position, SearchStackState* ss, NN::Accumulator* acc,
-    SearchSharedState& shared, SearchLocalState& local, Transposition::Entry* const tt_entry, const Score tt_eval,
+    SearchSharedState& shared, SearchLocalState& local, const bool tt_hit, const Score tt_eval,
     const Score tt_score, const SearchResultType tt_cutoff, int depth, int distance_from_root, bool in_check)
 {
     if (in_check)
@@ -755,7 +763,7 @@ std::tuple<Score, Score> get_search_eval(const GameState& position, SearchStackS
         return eval;
     };
 
-    if (tt_entry)
+    if (tt_hit)
     {
         if (tt_eval != SCORE_UNDEFINED)
         {
@@ -763,7 +771,8 @@ std::tuple<Score, Score> get_search_eval(const GameState& position, SearchStackS
         }
         else
         {
-            tt_entry->static_eval = raw_eval = evaluate(position.board(), acc, local.net);
+            raw_eval = evaluate(position.board(), acc, local.net);
+            shared.transposition_table.set_static_eval(Zobrist::get_fifty_move_adj_key(position.board()), raw_eval);
         }
 
         adjusted_eval = scale_eval_50_move(raw_eval);
@@ -920,7 +929,8 @@ Score search(GameState& position, SearchStackState* ss, NN::Accumulator* acc, Se
     }
 
     const auto [raw_eval, eval] = get_search_eval<false>(
-        position, ss, acc, shared, local, tt_entry, tt_eval, tt_score, tt_cutoff, depth, distance_from_root, InCheck);
+        position, ss, acc, shared, local, tt_entry.has_value(), tt_eval, tt_score, tt_cutoff, depth, distance_from_root,
+        InCheck);
     const bool improving = ss->adjusted_eval > (ss - 2)->adjusted_eval;
 
     // Step 8: Hindsight adjustments
@@ -1324,7 +1334,8 @@ Score qsearch(GameState& position, SearchStackState* ss, NN::Accumulator* acc, S
 
     const bool in_check = position.board().checkers;
     const auto [raw_eval, eval] = get_search_eval<true>(
-        position, ss, acc, shared, local, tt_entry, tt_eval, tt_score, tt_cutoff, 0, distance_from_root, in_check);
+        position, ss, acc, shared, local, tt_entry.has_value(), tt_eval, tt_score, tt_cutoff, 0, distance_from_root,
+        in_check);
     auto score = in_check ? std::numeric_limits<Score>::min() : eval;
 
     // Step 4: Stand-pat. We assume if all captures are bad, there's at least one quiet move that maintains the static
@@ -17,9 +17,13 @@
 #include "utility/static_vector.h"
 
 #include <algorithm>
+#include <cassert>
+#include <chrono>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <thread>
 #include <utility>
 
@@ -32,89 +36,101 @@ SearchThread::SearchThread(int thread_id, SearchSharedState& shared_state_)
 
 void SearchThread::thread_loop()
 {
-    while (!stop)
+    while (true)
     {
-        std::function<void()> task;
-
+        switch (wait_for_command())
         {
-            std::unique_lock lock(mutex);
-            cv.wait(lock, [this]() { return !tasks.empty(); });
-
-            task = std::move(tasks.front());
-            tasks.pop();
+        case Command::PrepareSearch:
+            local_state->position = *position_;
+            local_state->reset_new_search();
+            search_start_latency_ = {};
+            break;
+        case Command::ResetNewGame:
+            local_state = make_unique_huge_page<SearchLocalState>(thread_id_, shared_state.get_shared_hist(thread_id_));
+            break;
+        case Command::StartSearching:
+            local_state->position = *position_;
+            local_state->reset_new_search();
+            local_state->root_move_whitelist = *root_move_whitelist_;
+            search_start_latency_ = shared_state.search_timer.elapsed();
+            launch_worker_search(local_state->position, *local_state, shared_state);
+            break;
+        case Command::UpdatePreviousSearchScore:
+            local_state->prev_search_score = previous_search_score_;
+            break;
+        case Command::Terminate:
+            return;
+        case Command::Idle:
+            assert(false);
+            break;
         }
 
-        task();
+        auto* latch = latch_;
+        command.store(Command::Idle, std::memory_order_release);
+        latch->count_down();
     }
 }
 
-void SearchThread::enqueue_task(std::function<void()> func)
+SearchThread::Command SearchThread::wait_for_command()
 {
+    // Commands usually arrive in bursts (e.g a new game then a search), so we spin for a short while before going to
+    // sleep to avoid paying for the wake up
+    constexpr int spin_count = 1 << 12;
+
+    for (int i = 0; i < spin_count; i++)
     {
-        std::lock_guard lock(mutex);
-        tasks.push(std::move(func));
+        if (auto pending = command.load(std::memory_order_acquire); pending != Command::Idle)
+        {
+            return pending;
+        }
     }
 
-    cv.notify_one();
+    command.wait(Command::Idle, std::memory_order_acquire);
+    return command.load(std::memory_order_acquire);
 }
 
-void SearchThread::terminate()
+void SearchThread::post(Command command_, std::latch* latch)
 {
-    // due to the race of signaling the condition variable and destroying it we don't use enqueue_task here
-    std::lock_guard lock(mutex);
-    tasks.emplace([this]() { stop = true; });
-    cv.notify_one();
+    assert(command.load(std::memory_order_relaxed) == Command::Idle);
+    latch_ = latch;
+    command.store(command_, std::memory_order_release);
+    command.notify_one();
 }
 
-void SearchThread::set_position(std::latch& latch, const GameState& position)
+void SearchThread::terminate()
 {
-    enqueue_task(
-        [this, position, &latch]()
-        {
-            local_state->position = position;
-            latch.count_down();
-        });
+    post(Command::Terminate, nullptr);
 }
 
-void SearchThread::reset_new_search(std::latch& latch)
+void SearchThread::prepare_search(std::latch& latch, const GameState& position)
 {
-    enqueue_task(
-        [this, &latch]()
-        {
-            local_state->reset_new_search();
-            latch.count_down();
-        });
+    position_ = &position;
+    post(Command::PrepareSearch, &latch);
 }
 
 void SearchThread::reset_new_game(std::latch& latch)
 {
-    enqueue_task(
-        [this, &latch]()
-        {
-            local_state = make_unique_huge_page<SearchLocalState>(thread_id_, shared_state.get_shared_hist(thread_id_));
-            latch.count_down();
-        });
+    post(Command::ResetNewGame, &latch);
 }
 
-void SearchThread::start_searching(std::latch& latch, const BasicMoveList& root_move_whitelist)
+void SearchThread::start_searching(
+    std::latch& latch, const GameState& position, const BasicMoveList& root_move_whitelist)
 {
-    enqueue_task(
-        [this, root_move_whitelist, &latch]()
-        {
-            local_state->root_move_whitelist = root_move_whitelist;
-            launch_worker_search(local_state->position, *local_state, shared_state);
-            latch.count_down();
-        });
+    position_ = &position;
+    root_move_whitelist_ = &root_move_whitelist;
+    post(Command::StartSearching, &latch);
 }
 
 void SearchThread::update_previous_search_score(std::latch& latch, Score previous_search_score)
 {
-    enqueue_task(
-        [this, previous_search_score, &latch]()
-        {
-            local_state->prev_search_score = previous_search_score;
-            latch.count_down();
-        });
+    previous_search_score_ = previous_search_score;
+    post(Command::UpdatePreviousSearchScore, &latch);
+}
+
+void SearchThread::reset_shared_state()
+{
+    assert(command.load(std::memory_order_relaxed) == Command::Idle);
+    local_state->reset_shared_state();
 }
 
 const SearchLocalState& SearchThread::get_local_state()
@@ -122,6 +138,70 @@ const SearchLocalState& SearchThread::get_local_state()
     return *local_state;
 }
 
+std::chrono::nanoseconds SearchThread::get_search_start_latency() const
+{
+    return search_start_latency_;
+}
+
+SearchWatchdog::SearchWatchdog(SearchSharedState& shared_state_)
+    : shared_state(shared_state_)
+    , thread([this] { thread_loop(); })
+{
+}
+
+SearchWatchdog::~SearchWatchdog()
+{
+    {
+        std::lock_guard lock(mutex);
+        stop = true;
+    }
+
+    cv.notify_one();
+    thread.join();
+}
+
+void SearchWatchdog::arm(std::chrono::nanoseconds timeout)
+{
+    {
+        std::lock_guard lock(mutex);
+        deadline = std::chrono::steady_clock::now() + timeout;
+    }
+
+    cv.notify_one();
+}
+
+void SearchWatchdog::disarm()
+{
+    {
+        std::lock_guard lock(mutex);
+        deadline = std::nullopt;
+    }
+
+    cv.notify_one();
+}
+
+void SearchWatchdog::thread_loop()
+{
+    std::unique_lock lock(mutex);
+
+    while (!stop)
+    {
+        if (!deadline)
+        {
+            cv.wait(lock);
+        }
+        else if (std::chrono::steady_clock::now() >= *deadline)
+        {
+            shared_state.stop_searching = true;
+            deadline = std::nullopt;
+        }
+        else
+        {
+            cv.wait_until(lock, *deadline);
+        }
+    }
+}
+
 SearchThreadPool::SearchThreadPool(UCI::UciOutput& uci, size_t num_threads, size_t multi_pv, size_t hash_size_mb)
     : shared_state(uci)
 {
@@ -145,22 +225,16 @@ SearchThreadPool::~SearchThreadPool()
 
 void SearchThreadPool::set_position(const GameState& position)
 {
+    // the threads pick up the position when the search is launched
     position_ = position;
-    std::latch latch(search_threads.size());
-    for (auto* thread : search_threads)
-    {
-        thread->set_position(latch, position);
-    }
-    latch.wait();
 }
 
-void SearchThreadPool::reset_new_search()
+void SearchThreadPool::prepare_search()
 {
-    shared_state.reset_new_search();
     std::latch latch(search_threads.size());
-    for (auto* thread : search_threads)
+    for (auto& thread : search_threads)
     {
-        thread->reset_new_search(latch);
+        thread->prepare_search(latch, position_);
     }
     latch.wait();
 }
@@ -170,7 +244,7 @@ void SearchThreadPool::reset_new_game()
     shared_state.reset_new_game();
     position_ = GameState::starting_position();
     std::latch latch(search_threads.size());
-    for (auto* thread : search_threads)
+    for (auto& thread : search_threads)
     {
         thread->reset_new_game(latch);
     }
@@ -182,6 +256,26 @@ void SearchThreadPool::set_hash(int hash_size_mb, bool print)
     shared_state.set_hash(hash_size_mb, print);
 }
 
+std::optional<std::string> SearchThreadPool::save_hash(const std::string& path, int halfmove)
+{
+    return shared_state.save_hash(path, halfmove);
+}
+
+void SearchThreadPool::finish_hash_resize()
+{
+    shared_state.finish_hash_resize();
+}
+
+std::optional<std::string> SearchThreadPool::load_hash(const std::string& path, int halfmove)
+{
+    return shared_state.load_hash(path, halfmove);
+}
+
+void SearchThreadPool::record_tt_trace(std::vector<Transposition::TraceOp>* trace)
+{
+    shared_state.transposition_table.record_trace(trace);
+}
+
 void SearchThreadPool::set_multi_pv(int multi_pv)
 {
     shared_state.set_multi_pv(multi_pv);
@@ -222,7 +316,7 @@ void SearchThreadPool::set_threads(size_t threads)
 void SearchThreadPool::set_previous_search_score(Score previous_search_score)
 {
     std::latch latch(search_threads.size());
-    for (auto* thread : search_threads)
+    for (auto& thread : search_threads)
     {
         thread->update_previous_search_score(latch, previous_search_score);
     }
@@ -236,16 +330,19 @@ const SearchSharedState& SearchThreadPool::get_shared_state()
 
 void SearchThreadPool::create_thread()
 {
-    std::promise<SearchThread*> promise;
+    std::promise<std::unique_ptr<SearchThread>> promise;
     auto future = promise.get_future();
 
+    // The SearchThread is constructed on the new thread so its memory is allocated on the right NUMA node, but it is
+    // owned by the pool so it outlives the thread_loop
     std::thread native_thread(
         [this, &promise]() mutable
         {
             bind_thread(search_threads.size());
             auto thread = std::make_unique<SearchThread>(search_threads.size(), shared_state);
-            promise.set_value(thread.get());
-            thread->thread_loop();
+            auto* thread_ptr = thread.get();
+            promise.set_value(std::move(thread));
+            thread_ptr->thread_loop();
         });
 
     native_threads.push_back(std::move(native_thread));
@@ -255,20 +352,57 @@ void SearchThreadPool::create_thread()
 void SearchThreadPool::stop_search()
 {
     shared_state.stop_searching = true;
+    set_pondering(false);
+}
+
+void SearchThreadPool::set_pondering(bool pondering)
+{
+    shared_state.pondering = pondering;
+    shared_state.pondering.notify_all();
+}
+
+void SearchThreadPool::ponderhit()
+{
+    // The time limits apply from now on. Reset the timer before we stop pondering so the searching threads never see
+    // the limits measured from the start of the search.
+    shared_state.limits_timer.reset();
+    if (shared_state.limits.time)
+    {
+        watchdog.arm(shared_state.limits.time->abort_time());
+    }
+    set_pondering(false);
+}
+
+void SearchThreadPool::wait_for_ponderhit()
+{
+    // The UCI protocol doesn't allow us to send bestmove while pondering, even if the search has finished
+    shared_state.pondering.wait(true);
+}
+
+void SearchThreadPool::set_limits(const SearchLimits& limits)
+{
+    shared_state.reset_new_search();
+    shared_state.limits = limits;
 }
 
 SearchInfoData SearchThreadPool::launch_search(const SearchLimits& limits)
+{
+    set_limits(limits);
+    return launch_search();
+}
+
+SearchInfoData SearchThreadPool::launch_search()
 {
 #ifdef TUNE
     LMR_reduction = Initialise_LMR_reduction();
 #endif
 
-    reset_new_search();
-    shared_state.limits = limits;
+    // the clock started when the limits were set, so any time spent waiting for a hash resize counts against them
+    shared_state.finish_hash_resize();
 
     // TODO: a bit ugly
     shared_state.search_local_states_.clear();
-    for (auto* thread : search_threads)
+    for (auto& thread : search_threads)
     {
         shared_state.search_local_states_.push_back(&thread->get_local_state());
     }
@@ -288,9 +422,13 @@ SearchInfoData SearchThreadPool::launch_search(const SearchLimits& limits)
         = position_.is_repetition(0) || board.fifty_move_count >= 100 || insufficient_material(board);
     if (no_legal_moves || immediate_draw)
     {
+        // the threads reset for a new search as they start searching, so we need to do that here instead
+        prepare_search();
         const auto score = (no_legal_moves && board.checkers) ? Score::mated_in(0) : Score::draw();
         const auto search_result = shared_state.build_search_info(0, 0, score, 1, {}, SearchResultType::EXACT);
         shared_state.uci_handler.print_search_info(search_result, true, shared_state.chess_960);
+        wait_for_ponderhit();
+        watchdog.disarm();
         shared_state.uci_handler.print_bestmove(shared_state.chess_960, std::nullopt);
         set_previous_search_score(score);
         return search_result;
@@ -320,17 +458,47 @@ SearchInfoData SearchThreadPool::launch_search(const SearchLimits& limits)
     shared_state.set_multi_pv(multi_pv);
     shared_state.stop_searching = false;
 
+    // the limits are measured from when the search was reset, so the time spent probing the root above counts
+    if (shared_state.time_limits_apply())
+    {
+        watchdog.arm(shared_state.limits.time->abort_time() - shared_state.limits_timer.elapsed());
+    }
+
+    // Each thread resets itself for the new search and starts searching straight away, so launching a search only
+    // takes a single round trip. The first thread to start reads the node counts and stop votes of the others before
+    // they have reset themselves, so those are reset for every thread before any of them start. Posting the command
+    // publishes the reset.
+    for (auto& thread : search_threads)
+    {
+        thread->reset_shared_state();
+    }
+
     std::latch latch(search_threads.size());
-    for (auto* thread : search_threads)
+    for (auto& thread : search_threads)
     {
-        thread->start_searching(latch, root_move_whitelist);
+        thread->start_searching(latch, position_, root_move_whitelist);
     }
     latch.wait();
+    wait_for_ponderhit();
+
+    // a ponderhit may have armed the watchdog, even if the search had already finished
+    watchdog.disarm();
 
     const auto search_result = shared_state.get_best_root_move();
     shared_state.uci_handler.print_search_info(search_result, true, shared_state.chess_960);
-    shared_state.uci_handler.print_bestmove(shared_state.chess_960, search_result.pv[0]);
+    shared_state.uci_handler.print_bestmove(shared_state.chess_960, search_result.pv[0],
+        search_result.pv.size() >= 2 ? std::optional(search_result.pv[1]) : std::nullopt);
     shared_state.set_multi_pv(old_multi_pv);
     set_previous_search_score(search_result.score);
     return search_result;
+}
+
+std::chrono::nanoseconds SearchThreadPool::get_search_start_latency() const
+{
+    std::chrono::nanoseconds latency {};
+    for (const auto& thread : search_threads)
+    {
+        latency = std::max(latency, thread->get_search_start_latency());
+    }
+    return latency;
 }
\ No newline at end of file
@@ -4,14 +4,19 @@
 #include "movegen/list.h"
 #include "search/data.h"
 #include "search/score.h"
+#include "search/transposition/table.h"
 #include "utility/huge_pages.h"
 
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
-#include <functional>
+#include <cstdint>
 #include <latch>
+#include <memory>
 #include <mutex>
-#include <queue>
+#include <optional>
+#include <string>
 #include <thread>
 #include <vector>
 
@@ -29,25 +34,77 @@ public:
     void thread_loop();
     void terminate();
 
-    void set_position(std::latch& latch, const GameState& position);
-    void reset_new_search(std::latch& latch);
+    // The position and root move whitelist must outlive the latch
+    void prepare_search(std::latch& latch, const GameState& position);
     void reset_new_game(std::latch& latch);
-    void start_searching(std::latch& latch, const BasicMoveList& root_move_whitelist);
+    void start_searching(std::latch& latch, const GameState& position, const BasicMoveList& root_move_whitelist);
     void update_previous_search_score(std::latch& latch, Score previous_search_score);
 
+    // Resets the state of this thread that other threads read during a search. Only call while the thread is idle.
+    void reset_shared_state();
+
     const SearchLocalState& get_local_state();
 
-private:
-    std::mutex mutex;
-    std::condition_variable cv;
-    std::queue<std::function<void()>> tasks;
-    bool stop = false;
+    // The time from the search being launched until this thread started searching
+    std::chrono::nanoseconds get_search_start_latency() const;
 
-    void enqueue_task(std::function<void()> func);
+private:
+    enum class Command : uint32_t
+    {
+        Idle,
+        PrepareSearch,
+        ResetNewGame,
+        StartSearching,
+        UpdatePreviousSearchScore,
+        Terminate,
+    };
+
+    // A single slot mailbox. The pool writes the payload and then publishes the command, which the thread clears
+    // before counting down the latch. The pool always waits on the latch before posting again, so the slot is free
+    // whenever a command is posted and the payload can live on the pool's stack.
+    void post(Command command, std::latch* latch);
+    Command wait_for_command();
+
+    std::atomic<Command> command = Command::Idle;
+    std::latch* latch_ = nullptr;
+    const GameState* position_ = nullptr;
+    const BasicMoveList* root_move_whitelist_ = nullptr;
+    Score previous_search_score_ = 0;
 
     const int thread_id_;
     SearchSharedState& shared_state;
     unique_ptr_huge_page<SearchLocalState> local_state;
+    std::chrono::nanoseconds search_start_latency_ {};
+};
+
+// Sleeps until the search runs out of time and then stops it. This means the searching threads only need to check
+// stop_searching, rather than each reading the clock.
+class SearchWatchdog
+{
+public:
+    SearchWatchdog(SearchSharedState& shared_state);
+    ~SearchWatchdog();
+
+    SearchWatchdog(const SearchWatchdog&) = delete;
+    SearchWatchdog& operator=(const SearchWatchdog&) = delete;
+    SearchWatchdog(SearchWatchdog&&) = delete;
+    SearchWatchdog& operator=(SearchWatchdog&&) = delete;
+
+    // Stop the search once the timeout has elapsed from now. Replaces any previous timeout
+    void arm(std::chrono::nanoseconds timeout);
+    void disarm();
+
+private:
+    void thread_loop();
+
+    SearchSharedState& shared_state;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    bool stop = false;
+
+    std::thread thread;
 };
 
 class SearchThreadPool
@@ -61,26 +118,52 @@ public:
     SearchThreadPool(SearchThreadPool&&) = delete;
     SearchThreadPool& operator=(SearchThreadPool&&) = delete;
 
-    void reset_new_search();
     void reset_new_game();
 
     void set_position(const GameState& position);
     void set_hash(int hash_size_mb, bool print = false);
+    std::optional<std::string> save_hash(const std::string& path, int halfmove);
+    std::optional<std::string> load_hash(const std::string& path, int halfmove);
+
+    // Blocks until a resize of the transposition table started by set_hash is finished. Thread-safe.
+    void finish_hash_resize();
+
+    // Appends every transposition table probe and store to trace, or stops recording if trace is null. Only valid with
+    // a single search thread.
+    void record_tt_trace(std::vector<Transposition::TraceOp>* trace);
     void set_multi_pv(int multi_pv);
     void set_chess960(bool chess960);
     void set_threads(size_t threads);
     void set_previous_search_score(Score previous_search_score);
 
     SearchInfoData launch_search(const SearchLimits& limits);
+
+    // Launches a search with the limits already set by set_limits
+    SearchInfoData launch_search();
+
+    // Sets the limits of the next search and starts its clock. Must be called before launching a search on another
+    // thread, so that a ponderhit that arrives before the search starts sees these limits.
+    void set_limits(const SearchLimits& limits);
+
+    // The time from the last search being launched until every thread had started searching
+    std::chrono::nanoseconds get_search_start_latency() const;
     void stop_search();
 
+    // Must be set before launching a pondering search, so that a ponderhit or stop that arrives before the search
+    // starts isn't lost
+    void set_pondering(bool pondering);
+    void ponderhit();
+
     const SearchSharedState& get_shared_state();
 
 private:
     void create_thread();
+    void prepare_search();
+    void wait_for_ponderhit();
 
     std::vector<std::thread> native_threads;
-    std::vector<SearchThread*> search_threads;
+    std::vector<std::unique_ptr<SearchThread>> search_threads;
     SearchSharedState shared_state;
+    SearchWatchdog watchdog { shared_state };
     GameState position_ = GameState::starting_position();
 };
\ No newline at end of file
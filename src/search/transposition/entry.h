@@ -61,14 +61,41 @@ public:
     Meta meta; // 1 byte
 };
 
+static_assert(sizeof(Entry) == 10);
+
+#ifdef TT_CACHE_LINE_BUCKETS
+
+// 16 bytes. Every field of the entry but the key is packed into data, and the full key is stored xor'd with it. Each
+// word is read and written atomically, and a probe that sees the two words from different writes fails the key check
+// rather than returning a torn entry.
+struct PackedEntry
+{
+    uint64_t key_xor_data;
+    uint64_t data;
+};
+
+// Fills a cache line, so a probe never touches more than one
+struct alignas(64) Bucket : public std::array<PackedEntry, 4>
+{
+    constexpr static auto size = 4;
+};
+
+static_assert(sizeof(PackedEntry) == 16);
+static_assert(sizeof(Bucket) == 64);
+static_assert(alignof(Bucket) == 64);
+
+#else
+
 struct alignas(32) Bucket : public std::array<Entry, 3>
 {
     constexpr static auto size = 3;
 };
 
-static_assert(sizeof(Entry) == 10);
 static_assert(sizeof(Bucket) == 32);
 static_assert(alignof(Bucket) == 32);
+
+#endif
+
 static_assert(std::is_trivial_v<Bucket>);
 
 }
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include "search/transposition/stats.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <utility>
+
+namespace Transposition::Stats
+{
+
+#ifdef TT_STATS
+
+namespace
+{
+
+// Only the owning thread writes to these, other threads read them to print a summary
+struct ThreadCounters
+{
+    std::array<std::atomic<uint64_t>, N_COUNTERS> counters {};
+    std::array<std::atomic<uint64_t>, MAX_DEPTH + 1> stored_depths {};
+};
+
+// A deque never moves its elements. They are never freed either, so the counts of threads that have exited are kept.
+std::mutex registry_mutex;
+std::deque<ThreadCounters> registry;
+
+ThreadCounters& thread_counters()
+{
+    thread_local ThreadCounters* counters = []
+    {
+        std::lock_guard lock { registry_mutex };
+        return &registry.emplace_back();
+    }();
+    return *counters;
+}
+
+void bump(std::atomic<uint64_t>& counter)
+{
+    // single writer, so there's no need for a locked read-modify-write
+    counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+double percent(uint64_t numerator, uint64_t denominator)
+{
+    return denominator == 0 ? 0.0 : 100.0 * numerator / denominator;
+}
+
+}
+
+void increment(Counter counter)
+{
+    bump(thread_counters().counters[counter]);
+}
+
+void record_stored_depth(int depth)
+{
+    bump(thread_counters().stored_depths[std::clamp(depth, 0, MAX_DEPTH)]);
+}
+
+void reset()
+{
+    std::lock_guard lock { registry_mutex };
+    for (auto& thread : registry)
+    {
+        for (auto& counter : thread.counters)
+        {
+            counter.store(0, std::memory_order_relaxed);
+        }
+
+        for (auto& count : thread.stored_depths)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t total(Counter counter)
+{
+    std::lock_guard lock { registry_mutex };
+    uint64_t sum = 0;
+    for (const auto& thread : registry)
+    {
+        sum += thread.counters[counter].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void print(std::ostream& os)
+{
+    std::array<uint64_t, N_COUNTERS> counters {};
+    std::array<uint64_t, MAX_DEPTH + 1> depths {};
+    {
+        std::lock_guard lock { registry_mutex };
+        for (const auto& thread : registry)
+        {
+            for (size_t i = 0; i < N_COUNTERS; i++)
+            {
+                counters[i] += thread.counters[i].load(std::memory_order_relaxed);
+            }
+
+            for (size_t i = 0; i <= MAX_DEPTH; i++)
+            {
+                depths[i] += thread.stored_depths[i].load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    os << std::fixed << std::setprecision(2);
+    os << "tt probes: " << counters[PROBES] << " hit rate " << percent(counters[HITS], counters[PROBES])
+       << "% aliased " << percent(counters[ALIASED_HITS], counters[HITS]) << "% of hits cutoffs "
+       << percent(counters[CUTOFFS], counters[HITS]) << "% of hits\n";
+    os << "tt stores: " << counters[STORES] << " to empty " << percent(counters[STORES_TO_EMPTY], counters[STORES])
+       << "% to same key " << percent(counters[STORES_TO_SAME_KEY], counters[STORES]) << "% kept deeper "
+       << percent(counters[STORES_SKIPPED], counters[STORES]) << "% replacing other "
+       << percent(counters[STORES_REPLACING_OTHER], counters[STORES]) << "%\n";
+
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    for (int depth = 0; depth <= MAX_DEPTH; depth++)
+    {
+        total += depths[depth];
+        sum += depths[depth] * depth;
+    }
+
+    os << "tt stored depth: entries " << total;
+    if (total > 0)
+    {
+        os << " mean " << static_cast<double>(sum) / total << " qsearch " << percent(depths[0], total) << "%";
+
+        uint64_t seen = 0;
+        int depth = 0;
+        for (auto [label, fraction] : { std::pair { "p50", 0.5 }, { "p90", 0.9 }, { "p99", 0.99 } })
+        {
+            while (seen + depths[depth] < fraction * total)
+            {
+                seen += depths[depth++];
+            }
+            os << " " << label << " " << depth;
+        }
+
+        int max = MAX_DEPTH;
+        while (depths[max] == 0)
+        {
+            max--;
+        }
+        os << " max " << max << (max == MAX_DEPTH ? "+" : "");
+    }
+    os << "\n" << std::defaultfloat;
+}
+
+#endif
+
+}
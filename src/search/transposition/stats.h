@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+// Counters describing how the transposition table is probed and replaced. They are only compiled in when TT_STATS is
+// defined (make EXTRA_CXXFLAGS=-DTT_STATS), and otherwise the calls below compile away to nothing. Each thread counts
+// into its own set of counters, so they don't contend on shared cache lines.
+namespace Transposition::Stats
+{
+
+enum Counter : size_t
+{
+    PROBES,
+    HITS,
+    // hits whose move isn't legal in the probed position, so must be for a different position with the same stored key
+    ALIASED_HITS,
+    CUTOFFS,
+    STORES,
+    STORES_TO_EMPTY,
+    STORES_TO_SAME_KEY,
+    // a store for a position already in the bucket, which kept the existing deeper entry instead
+    STORES_SKIPPED,
+    STORES_REPLACING_OTHER,
+    N_COUNTERS
+};
+
+// Stored depths above this are recorded as MAX_DEPTH
+constexpr int MAX_DEPTH = 127;
+
+#ifdef TT_STATS
+
+constexpr bool enabled = true;
+
+void increment(Counter counter);
+void record_stored_depth(int depth);
+void reset();
+
+// The sum of a counter over every thread since the last reset
+uint64_t total(Counter counter);
+
+// Prints a summary of the counters of every thread since the last reset
+void print(std::ostream& os);
+
+#else
+
+constexpr bool enabled = false;
+
+inline void increment(Counter) { }
+inline void record_stored_depth(int) { }
+inline void reset() { }
+inline uint64_t total(Counter) { return 0; }
+inline void print(std::ostream&) { }
+
+#endif
+
+}
@@ -3,96 +3,388 @@
 #include "bitboard/define.h"
 #include "bitboard/enum.h"
 #include "movegen/move.h"
+#include "numa/numa.h"
 #include "search/transposition/entry.h"
+#include "search/transposition/stats.h"
 #include "spsa/tuneable.h"
 #include "utility/fraction.h"
 #include "utility/huge_pages.h"
+#include "utility/mapped_file.h"
+#include "utility/splitmix64.h"
 
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <ios>
 #include <iterator>
+#include <mutex>
+#include <optional>
+#include <string>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 namespace Transposition
 {
 
-void Table::add_entry(const Move& best, uint64_t ZobristKey, Score score, int Depth, int Turncount,
-    int distanceFromRoot, SearchResultType Cutoff, Score static_eval)
+size_t tt_index(uint64_t key, size_t tt_size)
+{
+    // multiply the key by tt_size and extract out the highest order 64 bits. This gives a uniform distribution where
+    // the index is determined by the higher order bits of key, for any tt_size
+
+#if defined(__GNUC__) && defined(__x86_64__)
+    __extension__ using uint128 = unsigned __int128;
+    return (uint128(key) * uint128(tt_size)) >> 64;
+#else
+    uint64_t aL = uint32_t(key), aH = key >> 32;
+    uint64_t bL = uint32_t(tt_size), bH = tt_size >> 32;
+    uint64_t c1 = (aL * bL) >> 32;
+    uint64_t c2 = aH * bL + c1;
+    uint64_t c3 = aL * bH + uint32_t(c2);
+    return aH * bH + (c2 >> 32) + (c3 >> 32);
+#endif
+}
+
+namespace
+{
+
+constexpr uint32_t SNAPSHOT_VERSION = 1;
+constexpr std::array<char, 8> SNAPSHOT_MAGIC = { 'H', 'A', 'L', 'O', 'G', 'E', 'N', 'T' };
+
+// Written at the start of a table snapshot, followed by the buckets. Padded so the buckets stay aligned in the file.
+struct SnapshotHeader
+{
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t bucket_size;
+    uint64_t bucket_count;
+    uint64_t network_hash;
+    uint64_t generation;
+    std::array<uint8_t, 24> unused;
+};
+
+static_assert(sizeof(SnapshotHeader) == 64);
+static_assert(sizeof(SnapshotHeader) % alignof(Bucket) == 0);
+static_assert(std::is_trivially_copyable_v<SnapshotHeader>);
+
+// Returns a * b / c, where a * b can be wider than 64 bits
+size_t mul_div(size_t a, size_t b, size_t c)
+{
+#if defined(__GNUC__) && defined(__x86_64__)
+    __extension__ using uint128 = unsigned __int128;
+    return (uint128(a) * uint128(b)) / c;
+#else
+    return static_cast<size_t>(static_cast<long double>(a) * b / c);
+#endif
+}
+
+#ifdef TT_CACHE_LINE_BUCKETS
+
+// The fields of an entry other than its key, in the layout they are packed into PackedEntry::data
+struct EntryData
+{
+    Move move;
+    Score score;
+    Score static_eval;
+    int8_t depth;
+    Meta meta;
+};
+
+static_assert(sizeof(EntryData) == sizeof(uint64_t));
+
+std::atomic_ref<uint64_t> word(uint64_t& value)
+{
+    return std::atomic_ref<uint64_t>(value);
+}
+
+// Returns the entry and the full key stored with it. If another thread wrote the entry between the two loads, the key
+// is garbage and won't match the one being probed.
+std::pair<Entry, uint64_t> read_slot(PackedEntry& slot)
+{
+    const auto data = word(slot.data).load(std::memory_order_relaxed);
+    const auto key = word(slot.key_xor_data).load(std::memory_order_relaxed) ^ data;
+    const auto fields = std::bit_cast<EntryData>(data);
+
+    Entry entry;
+    entry.key = uint16_t(key);
+    entry.move = fields.move;
+    entry.score = fields.score;
+    entry.static_eval = fields.static_eval;
+    entry.depth = fields.depth;
+    entry.meta = fields.meta;
+    return { entry, key };
+}
+
+bool keys_match(uint64_t stored_key, uint64_t key)
+{
+    return stored_key == key;
+}
+
+void write_slot(PackedEntry& slot, uint64_t key, const Entry& entry)
+{
+    const auto data = std::bit_cast<uint64_t>(
+        EntryData { entry.move, entry.score, entry.static_eval, entry.depth, entry.meta });
+    word(slot.data).store(data, std::memory_order_relaxed);
+    word(slot.key_xor_data).store(key ^ data, std::memory_order_relaxed);
+}
+
+// The generation and static eval share a word with the rest of the entry, so the whole entry is rewritten
+void write_generation(PackedEntry& slot, uint64_t key, const Entry& entry)
+{
+    write_slot(slot, key, entry);
+}
+
+void write_static_eval(PackedEntry& slot, uint64_t key, const Entry& entry)
+{
+    write_slot(slot, key, entry);
+}
+
+// Returns the bucket an entry belongs in after resizing the table to new_size buckets
+size_t rehash_index(uint64_t stored_key, size_t, size_t, size_t new_size)
+{
+    return tt_index(stored_key, new_size);
+}
+
+#else
+
+// Returns the entry and the key stored with it, which is only the low 16 bits of the full key
+std::pair<Entry, uint64_t> read_slot(const Entry& slot)
+{
+    return { slot, slot.key };
+}
+
+// Entries for different positions match if the low 16 bits of their keys are equal
+bool keys_match(uint64_t stored_key, uint64_t key)
 {
+    return stored_key == uint16_t(key);
+}
+
+void write_slot(Entry& slot, uint64_t key, const Entry& entry)
+{
+    slot = entry;
+    slot.key = uint16_t(key);
+}
+
+// Only the changed field is written, so a store to the rest of the entry by another thread isn't undone
+void write_generation(Entry& slot, uint64_t, const Entry& entry)
+{
+    slot.meta.generation = entry.meta.generation;
+}
+
+void write_static_eval(Entry& slot, uint64_t, const Entry& entry)
+{
+    slot.static_eval = entry.static_eval;
+}
+
+// Returns the bucket an entry belongs in after resizing the table to new_size buckets. The bucket index comes from the
+// high bits of the key, which aren't stored, so the new index is estimated from the middle of the range of keys that
+// map to old_index. This is right for almost all entries when the table shrinks, but when it grows only about
+// old_size / new_size of them land in the bucket they would be probed in.
+size_t rehash_index(uint64_t, size_t old_index, size_t old_size, size_t new_size)
+{
+    return mul_div(old_index * 2 + 1, new_size, old_size * 2);
+}
+
+#endif
+
+// Splits the table into one contiguous shard per thread, and calls f(begin, end) for each shard from a thread bound to
+// a NUMA node
+template <typename F>
+void for_each_shard(size_t size, int thread_count, F&& f)
+{
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < thread_count; i++)
+    {
+        threads.emplace_back(
+            [&f, size, i, thread_count]()
+            {
+                bind_thread(i);
+                const size_t begin = (size / thread_count) * i;
+                const size_t end = i + 1 != thread_count ? size / thread_count * (i + 1) : size;
+                f(begin, end);
+            });
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+}
+
+// The number of generations since an entry was written
+int age(const Entry& entry, int8_t generation)
+{
+    int8_t age_diff = generation - (int8_t)entry.meta.generation;
+    return age_diff >= 0 ? age_diff : age_diff + GENERATION_MAX;
+}
+
+}
+
+size_t DepthAgeReplacement::select(const std::array<Entry, Bucket::size>& entries, int, int8_t generation)
+{
+    std::array<int16_t, Bucket::size> scores = {};
+    for (size_t i = 0; i < Bucket::size; i++)
+    {
+        scores[i] = (tt_replace_depth * entries[i].depth - tt_replace_age * age(entries[i], generation)).to_int();
+    }
+
+    return std::distance(scores.begin(), std::min_element(scores.begin(), scores.end()));
+}
+
+size_t TwoTierReplacement::select(const std::array<Entry, Bucket::size>& entries, int depth, int8_t generation)
+{
+    if (entries[0].meta.generation != generation || depth >= entries[0].depth)
+    {
+        return 0;
+    }
+
+    size_t replaced = 1;
+    for (size_t i = 2; i < Bucket::size; i++)
+    {
+        const auto older = age(entries[i], generation) - age(entries[replaced], generation);
+        if (older > 0 || (older == 0 && entries[i].depth < entries[replaced].depth))
+        {
+            replaced = i;
+        }
+    }
+
+    return replaced;
+}
+
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::add_entry(const Move& best, uint64_t ZobristKey, Score score, int Depth,
+    int Turncount, int distanceFromRoot, SearchResultType Cutoff, Score static_eval)
+{
+    if constexpr (trace_enabled)
+    {
+        if (trace_)
+        {
+            trace_->push_back({ ZobristKey, static_cast<int16_t>(Turncount), static_cast<int8_t>(distanceFromRoot),
+                static_cast<int8_t>(Depth), Cutoff, true });
+        }
+    }
+
     score = convert_to_tt_score(score, distanceFromRoot);
-    auto key16 = uint16_t(ZobristKey);
     auto current_generation = get_generation(Turncount, distanceFromRoot);
-    std::array<int16_t, Bucket::size> scores = {};
+    std::array<Entry, Bucket::size> entries;
     auto& bucket = get_bucket(ZobristKey);
 
-    const auto write_to_entry = [&](auto& entry)
+    const auto write_to_entry = [&](auto& slot, Entry entry, uint64_t stored_key)
     {
         // in q-search we want to avoid overwriting the best move if we don't have one
-        if (best != Move::Uninitialized || entry.key != key16)
+        if (best != Move::Uninitialized || !keys_match(stored_key, ZobristKey))
         {
             entry.move = best;
         }
 
-        entry.key = key16;
         entry.score = score;
         entry.static_eval = static_eval;
         entry.depth = Depth;
         entry.meta = Meta { Cutoff, (uint8_t)current_generation };
+        write_slot(slot, ZobristKey, entry);
+        Stats::record_stored_depth(Depth);
     };
 
+    Stats::increment(Stats::STORES);
+
     for (size_t i = 0; i < Bucket::size; i++)
     {
+        const auto [entry, stored_key] = read_slot(bucket[i]);
+        entries[i] = entry;
+
         // each bucket fills from the first entry, and only once all entries are full do we use the replacement scheme
-        if (bucket[i].key == EMPTY)
+        if (stored_key == EMPTY)
         {
-            write_to_entry(bucket[i]);
+            Stats::increment(Stats::STORES_TO_EMPTY);
+            write_to_entry(bucket[i], entry, stored_key);
             return;
         }
 
         // avoid having multiple entries in a bucket for the same position.
-        if (bucket[i].key == key16)
+        if (keys_match(stored_key, ZobristKey))
         {
             // always replace if exact, or if the depth is sufficiently high. There's a trade-off here between wanting
             // to save the higher depth entry, and wanting to save the newer entry (which might have better bounds)
-            if (Cutoff == SearchResultType::EXACT || Depth >= bucket[i].depth - tt_replace_self_depth)
+            if (Cutoff == SearchResultType::EXACT || Depth >= entry.depth - tt_replace_self_depth)
             {
-                write_to_entry(bucket[i]);
+                Stats::increment(Stats::STORES_TO_SAME_KEY);
+                write_to_entry(bucket[i], entry, stored_key);
+            }
+            else
+            {
+                Stats::increment(Stats::STORES_SKIPPED);
             }
             return;
         }
-
-        Meta meta = bucket[i].meta;
-        int8_t age_diff = (int8_t)current_generation - (int8_t)meta.generation;
-        scores[i] = (tt_replace_depth * bucket[i].depth
-            - tt_replace_age * (age_diff >= 0 ? age_diff : age_diff + GENERATION_MAX))
-                        .to_int();
     }
 
-    write_to_entry(bucket[std::distance(scores.begin(), std::min_element(scores.begin(), scores.end()))]);
+    const auto replaced = ReplacementPolicy::select(entries, Depth, current_generation);
+    const auto [entry, stored_key] = read_slot(bucket[replaced]);
+    Stats::increment(Stats::STORES_REPLACING_OTHER);
+    write_to_entry(bucket[replaced], entry, stored_key);
 }
 
-Entry* Table::get_entry(uint64_t key, int distanceFromRoot, int half_turn_count)
+template <typename ReplacementPolicy>
+std::optional<Entry> BasicTable<ReplacementPolicy>::get_entry(uint64_t key, int distanceFromRoot, int half_turn_count)
 {
+    if constexpr (trace_enabled)
+    {
+        if (trace_)
+        {
+            trace_->push_back({ key, static_cast<int16_t>(half_turn_count), static_cast<int8_t>(distanceFromRoot), 0,
+                SearchResultType::EMPTY, false });
+        }
+    }
+
     auto& bucket = get_bucket(key);
-    auto key16 = uint16_t(key);
+    Stats::increment(Stats::PROBES);
 
     // we return by copy here because other threads are reading/writing to this same table.
-    for (auto& entry : bucket)
+    for (auto& slot : bucket)
     {
-        if (entry.key == key16)
+        auto [entry, stored_key] = read_slot(slot);
+        if (keys_match(stored_key, key))
         {
             // reset the age of this entry to mark it as not old
-            entry.meta.generation = get_generation(half_turn_count, distanceFromRoot);
-            return &entry;
+            const auto generation = get_generation(half_turn_count, distanceFromRoot);
+            if (entry.meta.generation != generation)
+            {
+                entry.meta.generation = generation;
+                write_generation(slot, key, entry);
+            }
+
+            Stats::increment(Stats::HITS);
+            return entry;
         }
     }
 
-    return nullptr;
+    return std::nullopt;
 }
 
-int Table::get_hashfull(int halfmove) const
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::set_static_eval(uint64_t key, Score static_eval)
+{
+    for (auto& slot : get_bucket(key))
+    {
+        auto [entry, stored_key] = read_slot(slot);
+        if (keys_match(stored_key, key))
+        {
+            entry.static_eval = static_eval;
+            write_static_eval(slot, key, entry);
+            return;
+        }
+    }
+}
+
+template <typename ReplacementPolicy>
+int BasicTable<ReplacementPolicy>::get_hashfull(int halfmove) const
 {
     int count = 0;
     int8_t current_generation = get_generation(halfmove, 0);
@@ -100,8 +392,8 @@ int Table::get_hashfull(int halfmove) const
     // 1000 chosen specifically, because result needs to be 'per mill'
     for (int i = 0; i < 1000; i++)
     {
-        auto& entry = table[i / Bucket::size][i % Bucket::size];
-        if (entry.key != EMPTY && entry.meta.generation == current_generation)
+        const auto [entry, stored_key] = read_slot(table[i / Bucket::size][i % Bucket::size]);
+        if (stored_key != EMPTY && entry.meta.generation == current_generation)
         {
             count++;
         }
@@ -110,62 +402,290 @@ int Table::get_hashfull(int halfmove) const
     return count;
 }
 
-void Table::clear(int thread_count)
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::clear(int thread_count)
 {
-    // For extremely large hash sizes, we clear the table using multiple threads
+    // For extremely large hash sizes, we clear the table using multiple threads. Each thread is bound to a NUMA node
+    // before it touches its shard, so the kernel's first-touch policy places that shard's pages on the same node. We
+    // always use at least one thread per node so the table ends up interleaved across all nodes rather than owned by
+    // whichever node happened to be clearing it.
 
-    std::vector<std::thread> threads;
+    thread_count = std::max(thread_count, static_cast<int>(get_numa_node_count()));
+    for_each_shard(size_, thread_count,
+        [this](size_t begin, size_t end) { std::fill(&table[begin], &table[end], Bucket {}); });
+}
 
-    for (int i = 0; i < thread_count; i++)
+template <typename ReplacementPolicy>
+std::optional<std::string> BasicTable<ReplacementPolicy>::save(
+    const std::string& path, int halfmove, uint64_t network_hash) const
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
     {
-        threads.emplace_back(
-            [this, i, thread_count]()
-            {
-                const size_t begin = (size_ / thread_count) * i;
-                const size_t end = i + 1 != thread_count ? size_ / thread_count * (i + 1) : size_;
-                std::fill(&table[begin], &table[end], Bucket {});
-            });
+        return "could not be opened for writing";
     }
 
-    for (auto& t : threads)
+    SnapshotHeader header {};
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.bucket_size = sizeof(Bucket);
+    header.bucket_count = size_;
+    header.network_hash = network_hash;
+    header.generation = get_generation(halfmove, 0);
+
+    // the buckets are written in a single call, which the stream passes straight through as one large write
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(table.get()), static_cast<std::streamsize>(size_ * sizeof(Bucket)));
+    file.close();
+
+    if (!file)
     {
-        t.join();
+        return "could not be written";
     }
+
+    return std::nullopt;
 }
 
-void Table::set_size(uint64_t MB, int thread_count)
+template <typename ReplacementPolicy>
+std::optional<std::string> BasicTable<ReplacementPolicy>::load(
+    const std::string& path, int halfmove, uint64_t network_hash, int thread_count)
 {
+    auto file = MappedFile::open(path);
+    if (!file)
+    {
+        return "could not be opened";
+    }
+
+    SnapshotHeader header;
+    if (file->size() < sizeof(header))
+    {
+        return "is not a hash file";
+    }
+
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != SNAPSHOT_MAGIC)
+    {
+        return "is not a hash file";
+    }
+
+    if (header.version != SNAPSHOT_VERSION)
+    {
+        return "has format version " + std::to_string(header.version) + ", expected "
+            + std::to_string(SNAPSHOT_VERSION);
+    }
+
+    if (header.bucket_size != sizeof(Bucket))
+    {
+        return "was saved with a different entry layout";
+    }
+
+    if (header.network_hash != network_hash)
+    {
+        return "was searched with a different network";
+    }
+
+    if (header.bucket_count != size_)
+    {
+        return "was saved from a " + std::to_string(header.bucket_count * sizeof(Bucket) / (1024 * 1024))
+            + " MB table. Set Hash to match before loading it";
+    }
+
+    if (file->size() != sizeof(header) + size_ * sizeof(Bucket))
+    {
+        return "is truncated";
+    }
+
+    // Shift every entry's generation by the distance between the two roots, so the replacement scheme sees them as no
+    // older than they were when saved
+    const int8_t generation_shift = get_generation(halfmove, 0) - static_cast<int8_t>(header.generation);
+    const auto* buckets = file->data() + sizeof(header);
+
+    // Each thread copies into its own shard, so the pages stay on the NUMA node that first touched them in clear()
+    thread_count = std::max(thread_count, static_cast<int>(get_numa_node_count()));
+    for_each_shard(size_, thread_count,
+        [&](size_t begin, size_t end)
+        {
+            std::memcpy(&table[begin], buckets + begin * sizeof(Bucket), (end - begin) * sizeof(Bucket));
+            for (size_t i = begin; i < end; i++)
+            {
+                for (auto& slot : table[i])
+                {
+                    auto [entry, stored_key] = read_slot(slot);
+                    if (stored_key != EMPTY)
+                    {
+                        entry.meta.generation = (entry.meta.generation + generation_shift + GENERATION_MAX)
+                            % GENERATION_MAX;
+                        write_slot(slot, stored_key, entry);
+                    }
+                }
+            }
+        });
+
+    return std::nullopt;
+}
+
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::set_size(uint64_t MB, int thread_count)
+{
+    finish_resize();
     size_ = MB * 1024 * 1024 / sizeof(Bucket);
     table = make_unique_for_overwrite_huge_page<Bucket[]>(size_);
     clear(thread_count);
 }
 
-void Table::prefetch(uint64_t key) const
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::start_resize(uint64_t MB, int thread_count)
+{
+    finish_resize();
+
+    const size_t new_size = MB * 1024 * 1024 / sizeof(Bucket);
+    if (new_size == size_)
+    {
+        return;
+    }
+
+    std::lock_guard lock(resize_mutex_);
+    resize_thread_ = std::thread(
+        [this, new_size, thread_count]()
+        {
+            const auto start = std::chrono::steady_clock::now();
+            const size_t old_size = size_;
+            auto new_table = make_unique_for_overwrite_huge_page<Bucket[]>(new_size);
+
+            // Each thread clears and then fills its own shard of the new table, so like clear() the pages are placed
+            // on the NUMA node of the thread that uses them. The entries that rehash into a shard come from a
+            // contiguous range of old buckets, because the bucket index is monotonic in the key.
+            for_each_shard(new_size, std::max(thread_count, static_cast<int>(get_numa_node_count())),
+                [&](size_t begin, size_t end)
+                {
+                    std::fill(&new_table[begin], &new_table[end], Bucket {});
+
+                    const auto old_begin = mul_div(begin, old_size, new_size);
+                    const auto old_end = std::min(mul_div(end, old_size, new_size) + 2, old_size);
+                    for (size_t i = old_begin > 0 ? old_begin - 1 : 0; i < old_end; i++)
+                    {
+                        for (auto& old_slot : table[i])
+                        {
+                            const auto [entry, stored_key] = read_slot(old_slot);
+                            const auto index = rehash_index(stored_key, i, old_size, new_size);
+                            if (stored_key == EMPTY || index < begin || index >= end)
+                            {
+                                continue;
+                            }
+
+                            // When the table shrinks several old buckets rehash into one, and the policy decides which
+                            // entries survive
+                            auto& bucket = new_table[index];
+                            std::array<Entry, Bucket::size> entries;
+                            size_t replaced = Bucket::size;
+                            for (size_t j = 0; j < Bucket::size && replaced == Bucket::size; j++)
+                            {
+                                const auto [new_entry, new_stored_key] = read_slot(bucket[j]);
+                                entries[j] = new_entry;
+                                if (new_stored_key == EMPTY)
+                                {
+                                    replaced = j;
+                                }
+                            }
+
+                            if (replaced == Bucket::size)
+                            {
+                                replaced = ReplacementPolicy::select(entries, entry.depth, entry.meta.generation);
+                            }
+
+                            write_slot(bucket[replaced], stored_key, entry);
+                        }
+                    }
+                });
+
+            resized_table_ = std::move(new_table);
+            resized_size_ = new_size;
+            resize_duration_ = std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - start);
+        });
+}
+
+template <typename ReplacementPolicy>
+std::optional<std::chrono::milliseconds> BasicTable<ReplacementPolicy>::finish_resize()
+{
+    std::lock_guard lock(resize_mutex_);
+    if (!resize_thread_.joinable())
+    {
+        return std::nullopt;
+    }
+
+    resize_thread_.join();
+    table = std::move(resized_table_);
+    size_ = resized_size_;
+    return resize_duration_;
+}
+
+template <typename ReplacementPolicy>
+BasicTable<ReplacementPolicy>::~BasicTable()
+{
+    finish_resize();
+}
+
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::prefetch(uint64_t key) const
 {
     __builtin_prefetch(&get_bucket(key));
 }
 
-size_t tt_index(uint64_t key, size_t tt_size)
+template <typename ReplacementPolicy>
+uint64_t BasicTable<ReplacementPolicy>::probe_chain(uint64_t key, size_t length) const
 {
-    // multiply the key by tt_size and extract out the highest order 64 bits. This gives a uniform distribution where
-    // the index is determined by the higher order bits of key, for any tt_size
+    for (size_t i = 0; i < length; i++)
+    {
+        // Fold the loaded entry into the next key, so each probe can't be issued until the previous one completes
+        key = SplitMix64(key ^ read_slot(get_bucket(key)[0]).second).next();
+    }
 
-#if defined(__GNUC__) && defined(__x86_64__)
-    __extension__ using uint128 = unsigned __int128;
-    return (uint128(key) * uint128(tt_size)) >> 64;
-#else
-    uint64_t aL = uint32_t(key), aH = key >> 32;
-    uint64_t bL = uint32_t(tt_size), bH = tt_size >> 32;
-    uint64_t c1 = (aL * bL) >> 32;
-    uint64_t c2 = aH * bL + c1;
-    uint64_t c3 = aL * bH + uint32_t(c2);
-    return aH * bH + (c2 >> 32) + (c3 >> 32);
-#endif
+    return key;
+}
+
+template <typename ReplacementPolicy>
+void BasicTable<ReplacementPolicy>::record_trace(std::vector<TraceOp>* trace)
+{
+    trace_ = trace;
 }
 
-Bucket& Table::get_bucket(uint64_t key) const
+template <typename ReplacementPolicy>
+ReplayResult BasicTable<ReplacementPolicy>::replay(const std::vector<TraceOp>& trace, uint64_t MB)
+{
+    BasicTable table;
+    table.set_size(MB, 1);
+    ReplayResult result;
+
+    for (const auto& op : trace)
+    {
+        if (op.is_store)
+        {
+            // the stored move and scores don't affect replacement, only the key, depth, bound and generation do
+            table.add_entry(Move::Uninitialized, op.key, 0, op.depth, op.half_turn_count, op.distance_from_root,
+                op.cutoff, SCORE_UNDEFINED);
+        }
+        else
+        {
+            result.probes++;
+            if (const auto entry = table.get_entry(op.key, op.distance_from_root, op.half_turn_count))
+            {
+                result.hits++;
+                result.hit_depths += entry->depth;
+            }
+        }
+    }
+
+    return result;
+}
+
+template <typename ReplacementPolicy>
+Bucket& BasicTable<ReplacementPolicy>::get_bucket(uint64_t key) const
 {
     return table[tt_index(key, size_)];
 }
 
+template class BasicTable<DepthAgeReplacement>;
+template class BasicTable<TwoTierReplacement>;
+
 }
\ No newline at end of file
@@ -4,8 +4,16 @@
 #include "search/transposition/entry.h"
 #include "utility/huge_pages.h"
 
+#include <array>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
 class Move;
 enum class SearchResultType : uint8_t;
@@ -13,15 +21,66 @@ enum class SearchResultType : uint8_t;
 namespace Transposition
 {
 
-class Table
+// Replacement policies choose which entry of a full bucket is replaced by a new entry for a position not yet in the
+// bucket. entries are in bucket order, and generation is that of the new entry.
+
+// Replaces the entry with the lowest score of depth minus age, weighted by tt_replace_depth and tt_replace_age
+struct DepthAgeReplacement
+{
+    constexpr static std::string_view name = "depth-age";
+    static size_t select(const std::array<Entry, Bucket::size>& entries, int depth, int8_t generation);
+};
+
+// The first entry of each bucket is depth-preferred: it keeps the deepest entry of the current search, and is only
+// replaced by an entry at least as deep or once it is left over from an earlier search. Other entries go to the rest
+// of the bucket, which always accepts them by replacing its oldest, then shallowest, entry.
+struct TwoTierReplacement
+{
+    constexpr static std::string_view name = "two-tier";
+    static size_t select(const std::array<Entry, Bucket::size>& entries, int depth, int8_t generation);
+};
+
+// Recording probes and stores is only compiled in when TT_TRACE is defined (make EXTRA_CXXFLAGS=-DTT_TRACE), so the
+// probe and store paths of other builds are unchanged
+#ifdef TT_TRACE
+constexpr bool trace_enabled = true;
+#else
+constexpr bool trace_enabled = false;
+#endif
+
+// A probe or store made by a search, recorded to be replayed against tables with other policies or sizes
+struct TraceOp
+{
+    uint64_t key;
+    int16_t half_turn_count;
+    int8_t distance_from_root;
+    int8_t depth;
+    SearchResultType cutoff;
+    bool is_store;
+};
+
+struct ReplayResult
+{
+    uint64_t probes = 0;
+    uint64_t hits = 0;
+
+    // the sum of the depths of the entries that were hit
+    uint64_t hit_depths = 0;
+};
+
+template <typename ReplacementPolicy>
+class BasicTable
 {
 public:
-    Table() = default;
+    constexpr static std::string_view policy_name = ReplacementPolicy::name;
 
-    Table(const Table&) = delete;
-    Table& operator=(const Table&) = delete;
-    Table(Table&&) = delete;
-    Table& operator=(Table&&) = delete;
+    BasicTable() = default;
+    ~BasicTable();
+
+    BasicTable(const BasicTable&) = delete;
+    BasicTable& operator=(const BasicTable&) = delete;
+    BasicTable(BasicTable&&) = delete;
+    BasicTable& operator=(BasicTable&&) = delete;
 
     [[nodiscard]] int get_hashfull(int halfmove) const;
 
@@ -30,19 +89,67 @@ public:
     // will wipe the table and reconstruct a new empty table with a set size. units in MB!
     void set_size(uint64_t MB, int thread_count);
 
+    // Starts building a table of a new size on a background thread, rehashing the current entries into it. The table
+    // must not be searched, written or read until finish_resize has been called, which switches to the new table.
+    // units in MB!
+    void start_resize(uint64_t MB, int thread_count);
+
+    // Waits for the resize started by start_resize, if there is one, and switches to the resized table. Returns how
+    // long the resize took, or nullopt if there was none to finish. Thread-safe.
+    std::optional<std::chrono::milliseconds> finish_resize();
+
     void add_entry(const Move& best, uint64_t ZobristKey, Score score, int Depth, int Turncount, int distanceFromRoot,
         SearchResultType Cutoff, Score static_eval);
 
+    // Writes the table to a file, along with the generation of the root at halfmove and a hash of the network the
+    // entries were searched with. Returns a description of the error if the file could not be written.
+    [[nodiscard]] std::optional<std::string> save(const std::string& path, int halfmove, uint64_t network_hash) const;
+
+    // Replaces the contents of the table with a file written by save. Files from a table of a different size, with a
+    // different entry layout, or searched with a different network are rejected, leaving the table unchanged. Entries
+    // keep their age relative to the root, which is now at halfmove. Returns a description of the error if the file
+    // could not be loaded.
+    [[nodiscard]] std::optional<std::string> load(
+        const std::string& path, int halfmove, uint64_t network_hash, int thread_count);
+
     void prefetch(uint64_t key) const;
 
+    // Performs length dependent probes, where each probed key is derived from the previous probe's result. Used to
+    // measure the memory latency of a probe, returns the final key.
+    [[nodiscard]] uint64_t probe_chain(uint64_t key, size_t length) const;
+
     // find a matching entry at any depth
-    Entry* get_entry(uint64_t key, int distanceFromRoot, int half_turn_count);
+    std::optional<Entry> get_entry(uint64_t key, int distanceFromRoot, int half_turn_count);
+
+    // Sets the static eval of the entry matching key, if it is still in the table
+    void set_static_eval(uint64_t key, Score static_eval);
+
+    // Appends every subsequent probe and store to trace, or stops recording if trace is null. Only for single threaded
+    // searches, and does nothing unless trace_enabled.
+    void record_trace(std::vector<TraceOp>* trace);
+
+    // Replays a trace against an empty table of this type and size, and counts the hits
+    [[nodiscard]] static ReplayResult replay(const std::vector<TraceOp>& trace, uint64_t MB);
 
 private:
     Bucket& get_bucket(uint64_t key) const;
 
     unique_ptr_huge_page<Bucket[]> table;
     size_t size_ = 0;
+    std::vector<TraceOp>* trace_ = nullptr;
+
+    // Written by the resize thread, and only read once it has been joined
+    std::mutex resize_mutex_;
+    std::thread resize_thread_;
+    unique_ptr_huge_page<Bucket[]> resized_table_;
+    size_t resized_size_ = 0;
+    std::chrono::milliseconds resize_duration_ {};
 };
 
+#ifdef TT_TWO_TIER_REPLACEMENT
+using Table = BasicTable<TwoTierReplacement>;
+#else
+using Table = BasicTable<DepthAgeReplacement>;
+#endif
+
 }
\ No newline at end of file
@@ -186,6 +186,20 @@ inline vecu8 set_u8_from_u32(uint32_t a)
 #endif
 }
 
+// Broadcast a pair of int16 values packed into a u32
+inline veci16 set_i16_from_u32(uint32_t a)
+{
+#if defined(USE_AVX512)
+    return _mm512_set1_epi32(static_cast<int32_t>(a));
+#elif defined(USE_AVX2)
+    return _mm256_set1_epi32(static_cast<int32_t>(a));
+#elif defined(USE_SSE4)
+    return _mm_set1_epi32(static_cast<int32_t>(a));
+#elif defined(USE_NEON)
+    return vreinterpretq_s16_u32(vdupq_n_u32(a));
+#endif
+}
+
 inline veci16 add_i16(const veci16& a, const veci16& b)
 {
 #if defined(USE_AVX512)
@@ -389,6 +403,22 @@ inline veci32 dpbusd_i32(const veci32& source, const vecu8& a, const veci8& b)
 #endif
 }
 
+// Multiply i16 pairs and add adjacent products into i32 lanes, accumulating into source
+inline veci32 madd_i16_i32(const veci32& source, const veci16& a, const veci16& b)
+{
+#if defined(USE_AVX512)
+    return _mm512_add_epi32(source, _mm512_madd_epi16(a, b));
+#elif defined(USE_AVX2)
+    return _mm256_add_epi32(source, _mm256_madd_epi16(a, b));
+#elif defined(USE_SSE4)
+    return _mm_add_epi32(source, _mm_madd_epi16(a, b));
+#elif defined(USE_NEON)
+    int32x4_t prod_low = vmull_s16(vget_low_s16(a), vget_low_s16(b));
+    int32x4_t prod_high = vmull_high_s16(a, b);
+    return vaddq_s32(source, vpaddq_s32(prod_low, prod_high));
+#endif
+}
+
 inline vecf32 i32_to_f32(const veci32& a)
 {
 #if defined(USE_AVX512)
@@ -1,4 +1 @@
-for i in $(seq 1 $(nproc --all));
-do
-    nice -19 taskset -c $[i - 1] ./Halogen-native "setoption name SyzygyPath value $1" "datagen output $i duration $2" > $i.log &
-done
\ No newline at end of file
+nice -19 ./Halogen-native "setoption name SyzygyPath value $1" "datagen output data threads $(nproc --all) duration $2" > datagen.log &
\ No newline at end of file
@@ -1,5 +1,5 @@
 // Load the network file, do some preprocessing, and then save it to the build directory for inclusion in the final
-// binary
+// binary. The output can also be loaded at runtime with the EvalFile option
 
 #include "network/arch.hpp"
 #include "network/inputs/king_bucket.h"
@@ -8,6 +8,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cmath>
 #include <cstdint>
 #include <cstdlib>
 #include <filesystem>
@@ -266,6 +267,61 @@ auto transpose_l2_weights(const decltype(raw_network::l2_weight)& input)
     return output;
 }
 
+// Quantizes the L2 and L3 layers for the integer inference path. The L2 weights are interleaved in pairs of inputs, so
+// that a pair of activations can be broadcast and multiplied with madd.
+bool quantize_l2_l3(const raw_network& raw_net, network& net)
+{
+    size_t clipped = 0;
+    for (size_t i = 0; i < OUTPUT_BUCKETS; i++)
+    {
+        for (size_t k = 0; k < L2_SIZE; k++)
+        {
+            net.l2_bias_int[i][k] = std::lround(raw_net.l2_bias[i][k] * L1_INT_ONE * L2_SCALE);
+
+            // the L1 activations are at most L1_INT_ONE, so bound the L2 sum to make sure it fits in an int32
+            int64_t max_output = std::abs(int64_t(net.l2_bias_int[i][k]));
+            for (size_t j = 0; j < L1_SIZE * 2; j++)
+            {
+                const auto weight = std::lround(raw_net.l2_weight[i][k][j] * L2_SCALE);
+                clipped += weight < INT16_MIN || weight > INT16_MAX;
+                const auto weight_int = static_cast<int16_t>(std::clamp<long>(weight, INT16_MIN, INT16_MAX));
+                net.l2_weight_int[i][(j / 2) * (2 * L2_SIZE) + k * 2 + j % 2] = weight_int;
+                max_output += std::abs(int64_t(weight_int)) * L1_INT_ONE;
+            }
+
+            if (max_output > INT32_MAX)
+            {
+                std::cout << "Error: L2 weights of output bucket " << i << " are too large for integer inference"
+                          << std::endl;
+                return false;
+            }
+        }
+
+        // likewise the L2 activations are rescaled to at most L2_INT_ONE
+        net.l3_bias_int[i] = std::lround(raw_net.l3_bias[i] * L2_INT_ONE * L3_SCALE);
+        int64_t max_output = std::abs(int64_t(net.l3_bias_int[i]));
+        for (size_t k = 0; k < L2_SIZE; k++)
+        {
+            net.l3_weight_int[i][k] = std::lround(raw_net.l3_weight[i][k] * L3_SCALE);
+            max_output += std::abs(int64_t(net.l3_weight_int[i][k])) * L2_INT_ONE;
+        }
+
+        if (max_output > INT32_MAX)
+        {
+            std::cout << "Error: L3 weights of output bucket " << i << " are too large for integer inference"
+                      << std::endl;
+            return false;
+        }
+    }
+
+    if (clipped > 0)
+    {
+        std::cout << "Warning: " << clipped << " L2 weights were clipped to fit in an int16" << std::endl;
+    }
+
+    return true;
+}
+
 }
 
 using namespace NN;
@@ -303,7 +359,14 @@ int main(int argc, char* argv[])
     final_net->l3_weight = raw_net->l3_weight;
     final_net->l3_bias = raw_net->l3_bias;
 
+    if (!quantize_l2_l3(*raw_net, *final_net))
+    {
+        return EXIT_FAILURE;
+    }
+
+    const network_header header;
     std::ofstream out(argv[2], std::ios::binary);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(network_header));
     out.write(reinterpret_cast<const char*>(final_net.get()), sizeof(network));
 
     std::cout << "Created embedded network" << std::endl;
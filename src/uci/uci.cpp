@@ -9,13 +9,19 @@
 #include "movegen/list.h"
 #include "movegen/move.h"
 #include "movegen/movegen.h"
+#include "network/microbench.h"
 #include "network/network.h"
+#include "network/stats.h"
+#include "numa/numa.h"
 #include "search/data.h"
 #include "search/limit/limits.h"
 #include "search/limit/time.h"
 #include "search/score.h"
 #include "search/syzygy.h"
 #include "search/thread.h"
+#include "search/transposition/entry.h"
+#include "search/transposition/stats.h"
+#include "search/transposition/table.h"
 #include "spsa/tuneable.h"
 #include "tools/sparse_shuffle.hpp" // IWYU pragma: keep
 #include "uci/options.h"
@@ -24,6 +30,7 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstdlib>
@@ -35,7 +42,9 @@
 #include <optional>
 #include <ratio>
 #include <sstream>
+#include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 namespace UCI
@@ -82,11 +91,64 @@ std::optional<OutputLevel> to_enum<OutputLevel>(std::string_view str)
     }
 }
 
-uint64_t Perft(int depth, GameState& position, bool check_legality)
+// A lockless table of perft subtree counts, shared between the perft threads. Each entry stores the key xor'd with the
+// node count, so an entry torn by two threads writing at once fails verification and is treated as a miss.
+class PerftTable
+{
+public:
+    explicit PerftTable(size_t size_mb)
+        : table_(std::max<size_t>(1, size_mb * 1024 * 1024 / sizeof(Entry)))
+    {
+    }
+
+    std::optional<uint64_t> probe(uint64_t key, int depth) const
+    {
+        key = mix(key, depth);
+        const auto& entry = table_[key % table_.size()];
+        auto nodes = entry.nodes.load(std::memory_order_relaxed);
+        auto check = entry.check.load(std::memory_order_relaxed);
+        return (check ^ nodes) == key ? std::optional(nodes) : std::nullopt;
+    }
+
+    void store(uint64_t key, int depth, uint64_t nodes)
+    {
+        key = mix(key, depth);
+        auto& entry = table_[key % table_.size()];
+        entry.nodes.store(nodes, std::memory_order_relaxed);
+        entry.check.store(key ^ nodes, std::memory_order_relaxed);
+    }
+
+private:
+    struct Entry
+    {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> nodes;
+    };
+
+    // the same position has a different count at each depth
+    static uint64_t mix(uint64_t key, int depth)
+    {
+        return key ^ (0x9E3779B97F4A7C15 * (depth + 1));
+    }
+
+    std::vector<Entry> table_;
+};
+
+uint64_t Perft(int depth, GameState& position, bool check_legality, PerftTable* table = nullptr)
 {
     if (depth == 0)
         return 1; // if perftdivide is called with 1 this is necesary
 
+    // probe before generating moves, so a hit skips the move generation. Depth 1 nodes are never stored, they're
+    // already counted by the move generation alone
+    if (table && depth >= 2)
+    {
+        if (auto nodes = table->probe(position.board().key, depth))
+        {
+            return *nodes;
+        }
+    }
+
     uint64_t nodeCount = 0;
     BasicMoveList moves;
     legal_moves(position.board(), moves);
@@ -111,93 +173,148 @@ uint64_t Perft(int depth, GameState& position, bool check_legality)
         }
     }
 
+    // bulk counting: the leaf moves are legal so we don't need to play them
     if (depth == 1)
         return moves.size();
 
     for (size_t i = 0; i < moves.size(); i++)
     {
         position.apply_move(moves[i]);
-        nodeCount += Perft(depth - 1, position, check_legality);
+        nodeCount += Perft(depth - 1, position, check_legality, table);
         position.revert_move();
     }
 
+    if (table)
+    {
+        table->store(position.board().key, depth, nodeCount);
+    }
+
     return nodeCount;
 }
 
+// Calls func(i) for each i in [0, count) spread over all hardware threads, handing out the indices one at a time so
+// that a few large subtrees don't leave the other threads idle.
+template <typename F>
+void parallel_for(size_t count, F&& func)
+{
+    std::atomic<size_t> next = 0;
+    auto worker = [&]
+    {
+        for (size_t i = next++; i < count; i = next++)
+        {
+            func(i);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    const size_t thread_count = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+    for (size_t i = 1; i < thread_count; i++)
+    {
+        threads.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
 void PerftSuite(std::string path, int depth_reduce, bool check_legality)
 {
     std::ifstream infile(path);
-
-    int Perfts = 0;
-    int Correct = 0;
-    double Totalnodes = 0;
+    std::vector<std::string> lines;
     std::string line;
 
-    auto before = std::chrono::steady_clock::now();
     while (getline(infile, line))
     {
-        std::vector<std::string> arrayTokens;
-        std::istringstream iss(line);
-        arrayTokens.clear();
+        lines.push_back(line);
+    }
 
-        do
+    std::atomic<int> Perfts = 0;
+    std::atomic<int> Correct = 0;
+    std::atomic<uint64_t> Totalnodes = 0;
+
+    // each position is run on a single thread, with the positions split between threads
+    auto before = std::chrono::steady_clock::now();
+    parallel_for(lines.size(),
+        [&](size_t index)
         {
-            std::string stub;
-            iss >> stub;
-            arrayTokens.push_back(stub);
-        } while (iss);
+            std::vector<std::string> arrayTokens;
+            std::istringstream iss(lines[index]);
 
-        std::string fen = arrayTokens[0] + " " + arrayTokens[1] + " " + arrayTokens[2] + " " + arrayTokens[3] + " "
-            + arrayTokens[4] + " " + arrayTokens[5];
+            do
+            {
+                std::string stub;
+                iss >> stub;
+                arrayTokens.push_back(stub);
+            } while (iss);
 
-        auto position = GameState::from_fen(fen);
+            std::string fen = arrayTokens[0] + " " + arrayTokens[1] + " " + arrayTokens[2] + " " + arrayTokens[3]
+                + " " + arrayTokens[4] + " " + arrayTokens[5];
 
-        int depth = (arrayTokens.size() - 7) / 2 - depth_reduce;
-        uint64_t nodes = Perft(depth, position, check_legality);
-        uint64_t correct = stoull(arrayTokens.at(arrayTokens.size() - 2 * (1 + depth_reduce)));
-        if (nodes == stoull(arrayTokens.at(arrayTokens.size() - 2 * (1 + depth_reduce))))
-        {
-            std::lock_guard io { output_mutex };
-            std::cout << "CORRECT   (" << nodes << " == " << correct << ") [" << fen << "] depth: " << depth
-                      << std::endl;
-            Correct++;
-        }
-        else
-        {
-            std::lock_guard io { output_mutex };
-            std::cout << "INCORRECT (" << nodes << " != " << correct << ") [" << fen << "] depth: " << depth
-                      << std::endl;
-        }
+            auto position = GameState::from_fen(fen);
 
-        Totalnodes += nodes;
-        Perfts++;
-    }
+            int depth = (arrayTokens.size() - 7) / 2 - depth_reduce;
+            uint64_t nodes = Perft(depth, position, check_legality);
+            uint64_t correct = stoull(arrayTokens.at(arrayTokens.size() - 2 * (1 + depth_reduce)));
+            if (nodes == correct)
+            {
+                std::lock_guard io { output_mutex };
+                std::cout << "CORRECT   (" << nodes << " == " << correct << ") [" << fen << "] depth: " << depth
+                          << std::endl;
+                Correct++;
+            }
+            else
+            {
+                std::lock_guard io { output_mutex };
+                std::cout << "INCORRECT (" << nodes << " != " << correct << ") [" << fen << "] depth: " << depth
+                          << std::endl;
+            }
+
+            Totalnodes += nodes;
+            Perfts++;
+        });
     auto after = std::chrono::steady_clock::now();
     auto duration = std::chrono::duration<double>(after - before).count();
 
     std::lock_guard io { output_mutex };
     std::cout << "\n\nCompleted perft with: " << Correct << "/" << Perfts << " correct";
     std::cout << "\nTotal nodes: " << (Totalnodes) << " in " << duration << "s";
-    std::cout << "\nNodes per second: " << static_cast<int>(Totalnodes / duration);
+    std::cout << "\nNodes per second: " << static_cast<int64_t>(Totalnodes / duration);
     std::cout << std::endl;
 }
 
-uint64_t PerftDivide(int depth, GameState& position, bool check_legality)
+uint64_t PerftDivide(int depth, const GameState& position, bool check_legality, size_t hash_mb = 0)
 {
     auto before = std::chrono::steady_clock::now();
 
-    uint64_t nodeCount = 0;
+    std::optional<PerftTable> table;
+    if (hash_mb > 0)
+    {
+        table.emplace(hash_mb);
+    }
+
     BasicMoveList moves;
     legal_moves(position.board(), moves);
+    std::vector<uint64_t> child_node_counts(moves.size());
 
+    // split the root moves between threads
+    parallel_for(moves.size(),
+        [&](size_t i)
+        {
+            auto child = position;
+            child.apply_move(moves[i]);
+            child_node_counts[i] = Perft(depth - 1, child, check_legality, table ? &*table : nullptr);
+        });
+
+    uint64_t nodeCount = 0;
     for (size_t i = 0; i < moves.size(); i++)
     {
-        position.apply_move(moves[i]);
-        uint64_t ChildNodeCount = Perft(depth - 1, position, check_legality);
-        position.revert_move();
         std::lock_guard io { output_mutex };
-        std::cout << moves[i] << ": " << ChildNodeCount << std::endl;
-        nodeCount += ChildNodeCount;
+        std::cout << moves[i] << ": " << child_node_counts[i] << std::endl;
+        nodeCount += child_node_counts[i];
     }
 
     auto after = std::chrono::steady_clock::now();
@@ -205,7 +322,7 @@ uint64_t PerftDivide(int depth, GameState& position, bool check_legality)
 
     std::lock_guard io { output_mutex };
     std::cout << "\nNodes searched: " << (nodeCount) << " in " << duration << " seconds ";
-    std::cout << "(" << static_cast<int>(nodeCount / duration) << " nps)" << std::endl;
+    std::cout << "(" << static_cast<int64_t>(nodeCount / duration) << " nps)" << std::endl;
     return nodeCount;
 }
 
@@ -229,7 +346,11 @@ void Uci::handle_bench(const SearchLimits& limits)
     Timer timer;
 
     uint64_t nodeCount = 0;
+    std::chrono::nanoseconds total_start_latency {};
+    std::chrono::nanoseconds max_start_latency {};
     auto parse_position = position_command_handler();
+    NN::Stats::reset();
+    Transposition::Stats::reset();
 
     for (size_t i = 0; i < benchMarkPositions.size(); i++)
     {
@@ -245,13 +366,425 @@ void Uci::handle_bench(const SearchLimits& limits)
         search_thread_pool.set_position(position);
         auto result = search_thread_pool.launch_search(limits);
         nodeCount += result.nodes;
+
+        auto start_latency = search_thread_pool.get_search_start_latency();
+        total_start_latency += start_latency;
+        max_start_latency = std::max(max_start_latency, start_latency);
     }
 
     int elapsed_time = std::chrono::duration_cast<std::chrono::milliseconds>(timer.elapsed()).count();
     std::lock_guard io { output_mutex };
+
+    // time from launching the search until every thread has started searching
+    using micros = std::chrono::duration<double, std::micro>;
+    std::cout << "search start latency: avg " << std::fixed << std::setprecision(1)
+              << micros(total_start_latency).count() / benchMarkPositions.size() << " us max "
+              << micros(max_start_latency).count() << " us" << std::defaultfloat << std::endl;
+
+    NN::Stats::print(std::cout);
+    Transposition::Stats::print(std::cout);
     std::cout << nodeCount << " nodes " << nodeCount / std::max(elapsed_time, 1) * 1000 << " nps" << std::endl;
 }
 
+// Prints the TT hit rate since the stats were last reset, which is only measured when built with TT_STATS
+void print_tt_hit_rate(std::ostream& os, int width)
+{
+    if constexpr (Transposition::Stats::enabled)
+    {
+        const auto probes = Transposition::Stats::total(Transposition::Stats::PROBES);
+        const auto hits = Transposition::Stats::total(Transposition::Stats::HITS);
+        os << std::setw(width - 1) << std::fixed << std::setprecision(1)
+           << 100.0 * hits / std::max<uint64_t>(probes, 1) << "%" << std::defaultfloat;
+    }
+    else
+    {
+        os << std::setw(width) << "-";
+    }
+}
+
+// Returns the bench positions and every position one legal move away from them
+std::vector<BoardState> bench_positions_and_children()
+{
+    std::vector<BoardState> boards;
+    for (const auto& fen : benchMarkPositions)
+    {
+        auto game = GameState::from_fen(fen);
+        boards.push_back(game.board());
+        BasicMoveList moves;
+        legal_moves(game.board(), moves);
+        for (const auto& move : moves)
+        {
+            game.apply_move(move);
+            boards.push_back(game.board());
+            game.revert_move();
+        }
+    }
+    return boards;
+}
+
+void Uci::handle_bench_eval_batch()
+{
+    // Evaluate the bench positions and every position one legal move away from them, first one at a time and then as a
+    // batch. The accumulators are calculated up front, so only inference is timed.
+    constexpr int rounds = 200;
+
+    const auto boards = bench_positions_and_children();
+    NN::Network network(0);
+    std::vector<NN::Accumulator> accs(boards.size());
+    std::vector<const BoardState*> board_ptrs(boards.size());
+    std::vector<const NN::Accumulator*> acc_ptrs(boards.size());
+    for (size_t i = 0; i < boards.size(); i++)
+    {
+        accs[i].recalculate(boards[i], NN::get_network(0));
+        board_ptrs[i] = &boards[i];
+        acc_ptrs[i] = &accs[i];
+    }
+
+    std::vector<Score> single_scores(boards.size());
+    Timer timer;
+    for (int round = 0; round < rounds; round++)
+    {
+        for (size_t i = 0; i < boards.size(); i++)
+        {
+            single_scores[i] = network.eval(boards[i], accs[i]);
+        }
+    }
+    const auto single_elapsed = timer.elapsed();
+
+    std::vector<Score> batch_scores(boards.size());
+    timer.reset();
+    for (int round = 0; round < rounds; round++)
+    {
+        network.eval_batch(board_ptrs, acc_ptrs, batch_scores);
+    }
+    const auto batch_elapsed = timer.elapsed();
+
+    const double evals = static_cast<double>(boards.size()) * rounds;
+    const auto per_second = [&](auto elapsed) { return evals / std::chrono::duration<double>(elapsed).count(); };
+
+    std::lock_guard io { output_mutex };
+    std::cout << "positions: " << boards.size() << " rounds: " << rounds << std::endl;
+    std::cout << std::fixed << std::setprecision(0) << "single: " << per_second(single_elapsed) << " pos/s" << std::endl;
+    std::cout << "batch: " << per_second(batch_elapsed) << " pos/s (" << std::setprecision(2)
+              << per_second(batch_elapsed) / per_second(single_elapsed) << "x)" << std::defaultfloat << std::endl;
+
+    if (single_scores != batch_scores)
+    {
+        std::cout << "Error: batched scores differ from single position scores" << std::endl;
+    }
+}
+
+void Uci::handle_bench_eval_int(const SearchLimits& limits)
+{
+    // Compare the float and integer L2/L3 paths: first the eval difference and inference speed on the bench positions
+    // and their children, then the NPS of a bench search with each path.
+    constexpr int rounds = 200;
+
+    const auto boards = bench_positions_and_children();
+    NN::Network network(0);
+    std::vector<NN::Accumulator> accs(boards.size());
+    for (size_t i = 0; i < boards.size(); i++)
+    {
+        accs[i].recalculate(boards[i], NN::get_network(0));
+    }
+
+    const auto time_evals = [&](bool integer, std::vector<Score>& scores)
+    {
+        Timer timer;
+        for (int round = 0; round < rounds; round++)
+        {
+            for (size_t i = 0; i < boards.size(); i++)
+            {
+                scores[i] = network.eval(boards[i], accs[i], integer);
+            }
+        }
+        return static_cast<double>(boards.size()) * rounds / std::chrono::duration<double>(timer.elapsed()).count();
+    };
+
+    std::vector<Score> float_scores(boards.size());
+    std::vector<Score> int_scores(boards.size());
+    const auto float_evals_per_second = time_evals(false, float_scores);
+    const auto int_evals_per_second = time_evals(true, int_scores);
+
+    int64_t total_delta = 0;
+    int max_delta = 0;
+    size_t exact = 0;
+    for (size_t i = 0; i < boards.size(); i++)
+    {
+        const int delta = std::abs(float_scores[i].value() - int_scores[i].value());
+        total_delta += delta;
+        max_delta = std::max(max_delta, delta);
+        exact += delta == 0;
+    }
+
+    const auto search_nps = [&](bool integer)
+    {
+        NN::set_integer_inference(integer);
+        search_thread_pool.reset_new_game();
+        auto parse_position = position_command_handler();
+        uint64_t nodes = 0;
+        Timer timer;
+        for (const auto& fen : benchMarkPositions)
+        {
+            std::string command = std::string("fen ") + fen;
+            std::string_view command_view = command;
+            parse_position(command_view);
+            search_thread_pool.set_position(position);
+            nodes += search_thread_pool.launch_search(limits).nodes;
+        }
+        return std::pair { nodes, nodes / std::chrono::duration<double>(timer.elapsed()).count() };
+    };
+
+    const auto [float_nodes, float_nps] = search_nps(false);
+    const auto [int_nodes, int_nps] = search_nps(true);
+    NN::set_integer_inference(integer_inference);
+    search_thread_pool.reset_new_game();
+
+    std::lock_guard io { output_mutex };
+    std::cout << "positions: " << boards.size() << " rounds: " << rounds << std::endl;
+    std::cout << "eval delta: mean " << std::fixed << std::setprecision(2)
+              << static_cast<double>(total_delta) / boards.size() << " max " << max_delta << " exact "
+              << 100.0 * exact / boards.size() << "%" << std::endl;
+    std::cout << std::setprecision(0) << "float: " << float_evals_per_second << " evals/s " << float_nodes
+              << " nodes " << float_nps << " nps" << std::endl;
+    std::cout << "integer: " << int_evals_per_second << " evals/s " << int_nodes << " nodes " << int_nps << " nps ("
+              << std::setprecision(2) << int_nps / float_nps << "x)" << std::defaultfloat << std::endl;
+}
+
+void Uci::handle_bench_nnue()
+{
+    std::lock_guard io { output_mutex };
+    NN::run_microbench(std::cout);
+}
+
+void Uci::handle_bench_tt()
+{
+    // Measure the latency of a dependent chain of TT probes from a thread bound to each NUMA node. If the table is
+    // well interleaved, every node should see a similar latency. Afterwards, run the regular bench to measure NPS.
+    constexpr size_t probe_count = 1'000'000;
+    search_thread_pool.finish_hash_resize();
+    const auto& shared_state = search_thread_pool.get_shared_state();
+
+    {
+        std::lock_guard io { output_mutex };
+        std::cout << "numa nodes: " << get_numa_node_count() << " threads: " << shared_state.get_threads_setting()
+                  << std::endl;
+    }
+
+    for (size_t node = 0; node < get_numa_node_count(); node++)
+    {
+        std::chrono::duration<double, std::nano> elapsed {};
+        std::thread(
+            [&]
+            {
+                bind_thread(node);
+                Timer timer;
+                [[maybe_unused]] volatile auto key = shared_state.transposition_table.probe_chain(node, probe_count);
+                elapsed = timer.elapsed();
+            })
+            .join();
+
+        std::lock_guard io { output_mutex };
+        std::cout << "node " << node << " probe latency: " << std::fixed << std::setprecision(1)
+                  << elapsed.count() / probe_count << " ns" << std::defaultfloat << std::endl;
+    }
+
+    handle_bench(SearchLimits { .depth = 14 });
+}
+
+void Uci::handle_bench_smp(const SearchLimits& limits)
+{
+    // Run the bench positions for each combination of thread count and hash size, to measure how well Lazy SMP scales.
+    // Efficiency compares the NPS against the single threaded run with the same hash size, and time is the total
+    // time to reach the bench depth. NUMA thread binding and the TT bucket layout are decided at compile time
+    // (tournament builds bind threads, TT_CACHE_LINE_BUCKETS selects 64 byte buckets), so to compare them run this with
+    // each binary. The tt hit rate is only measured when built with TT_STATS.
+    const auto& shared_state = search_thread_pool.get_shared_state();
+    const auto old_threads = shared_state.get_threads_setting();
+    const auto old_hash = shared_state.get_hash_setting();
+    const auto old_output_level = output.output_level;
+
+    std::vector<int> thread_counts;
+    const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads < max_threads; threads *= 2)
+    {
+        thread_counts.push_back(threads);
+    }
+    thread_counts.push_back(max_threads);
+
+    constexpr std::array hash_sizes = { 16, 64, 256 };
+
+    {
+        std::lock_guard io { output_mutex };
+#ifdef TOURNAMENT_MODE
+        constexpr bool numa_binding = true;
+#else
+        constexpr bool numa_binding = false;
+#endif
+        std::cout << "numa nodes: " << get_numa_node_count() << " thread binding: " << (numa_binding ? "on" : "off")
+                  << " tt bucket: " << sizeof(Transposition::Bucket) << " bytes, " << Transposition::Bucket::size
+                  << " entries depth: " << limits.depth.value_or(0) << std::endl;
+        std::cout << std::setw(8) << "threads" << std::setw(8) << "hash" << std::setw(12) << "nodes" << std::setw(10)
+                  << "time" << std::setw(12) << "nps" << std::setw(12) << "efficiency" << std::setw(10) << "hashfull"
+                  << std::setw(10) << "tt hits" << std::endl;
+    }
+
+    output.output_level = OutputLevel::None;
+    auto parse_position = position_command_handler();
+
+    for (auto hash : hash_sizes)
+    {
+        double single_thread_nps = 0;
+
+        for (auto threads : thread_counts)
+        {
+            handle_setoption_threads(threads);
+            handle_setoption_hash(hash);
+            search_thread_pool.reset_new_game();
+
+            uint64_t nodes = 0;
+            int hashfull = 0;
+            Transposition::Stats::reset();
+            Timer timer;
+
+            for (const auto& fen : benchMarkPositions)
+            {
+                std::string command = std::string("fen ") + fen;
+                std::string_view command_view = command;
+                parse_position(command_view);
+                search_thread_pool.set_position(position);
+                auto result = search_thread_pool.launch_search(limits);
+                nodes += result.nodes;
+                hashfull += result.hashfull;
+            }
+
+            auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timer.elapsed()).count();
+            auto nps = nodes * 1000.0 / std::max<int64_t>(elapsed_ms, 1);
+            if (threads == 1)
+            {
+                single_thread_nps = nps;
+            }
+
+            std::lock_guard io { output_mutex };
+            std::cout << std::setw(8) << threads << std::setw(8) << hash << std::setw(12) << nodes << std::setw(10)
+                      << elapsed_ms << std::setw(12) << static_cast<uint64_t>(nps) << std::setw(11) << std::fixed
+                      << std::setprecision(1) << nps / (single_thread_nps * threads) * 100 << "%" << std::setw(10)
+                      << hashfull / static_cast<int>(benchMarkPositions.size()) << std::defaultfloat;
+            print_tt_hit_rate(std::cout, 10);
+            std::cout << std::endl;
+        }
+    }
+
+    handle_setoption_threads(old_threads);
+    handle_setoption_hash(old_hash);
+    search_thread_pool.reset_new_game();
+    output.output_level = old_output_level;
+}
+
+void Uci::handle_bench_tt_replacement(const SearchLimits& limits)
+{
+    // Compare the TT replacement policies under memory pressure. The probes and stores of a single threaded search of
+    // the bench positions are recorded once, then replayed against a table of each policy and hash size, so every
+    // policy sees exactly the same sequence of positions. The replay can't show how a policy changes the search
+    // itself, so afterwards the bench is searched live at each hash size with the policy this binary was built with
+    // (TT_TWO_TIER_REPLACEMENT selects the two-tier policy). Its tt hit rate is only measured when built with TT_STATS.
+    if constexpr (!Transposition::trace_enabled)
+    {
+        std::lock_guard io { output_mutex };
+        std::cout << "info string tt tracing is not compiled in, rebuild with make EXTRA_CXXFLAGS=-DTT_TRACE"
+                  << std::endl;
+        return;
+    }
+
+    const auto& shared_state = search_thread_pool.get_shared_state();
+    const auto old_threads = shared_state.get_threads_setting();
+    const auto old_hash = shared_state.get_hash_setting();
+    const auto old_output_level = output.output_level;
+
+    constexpr std::array hash_sizes = { 1, 4, 16 };
+
+    output.output_level = OutputLevel::None;
+    auto parse_position = position_command_handler();
+
+    const auto search_bench_positions = [&]
+    {
+        uint64_t nodes = 0;
+        for (const auto& fen : benchMarkPositions)
+        {
+            std::string command = std::string("fen ") + fen;
+            std::string_view command_view = command;
+            parse_position(command_view);
+            search_thread_pool.set_position(position);
+            nodes += search_thread_pool.launch_search(limits).nodes;
+        }
+        return nodes;
+    };
+
+    handle_setoption_threads(1);
+    handle_setoption_hash(hash_sizes.back());
+    search_thread_pool.reset_new_game();
+
+    std::vector<Transposition::TraceOp> trace;
+    search_thread_pool.record_tt_trace(&trace);
+    search_bench_positions();
+    search_thread_pool.record_tt_trace(nullptr);
+
+    const auto print_replay = [&]<typename Policy>()
+    {
+        for (auto hash : hash_sizes)
+        {
+            const auto result = Transposition::BasicTable<Policy>::replay(trace, hash);
+            std::lock_guard io { output_mutex };
+            std::cout << std::setw(12) << Policy::name << std::setw(8) << hash << std::setw(12) << result.probes
+                      << std::setw(9) << std::fixed << std::setprecision(1)
+                      << 100.0 * result.hits / std::max<uint64_t>(result.probes, 1) << "%" << std::setw(12)
+                      << static_cast<double>(result.hit_depths) / std::max<uint64_t>(result.hits, 1)
+                      << std::defaultfloat << std::endl;
+        }
+    };
+
+    {
+        std::lock_guard io { output_mutex };
+        std::cout << "replay of " << trace.size() << " tt operations, depth: " << limits.depth.value_or(0) << std::endl;
+        std::cout << std::setw(12) << "policy" << std::setw(8) << "hash" << std::setw(12) << "probes" << std::setw(10)
+                  << "hits" << std::setw(12) << "hit depth" << std::endl;
+    }
+
+    print_replay.template operator()<Transposition::DepthAgeReplacement>();
+    print_replay.template operator()<Transposition::TwoTierReplacement>();
+
+    // release the trace before the live searches, it can be much larger than the tables
+    trace = {};
+
+    {
+        std::lock_guard io { output_mutex };
+        std::cout << "live search with " << Transposition::Table::policy_name << std::endl;
+        std::cout << std::setw(8) << "hash" << std::setw(12) << "nodes" << std::setw(10) << "time" << std::setw(10)
+                  << "tt hits" << std::endl;
+    }
+
+    for (auto hash : hash_sizes)
+    {
+        handle_setoption_hash(hash);
+        search_thread_pool.reset_new_game();
+
+        Transposition::Stats::reset();
+        Timer timer;
+        const auto nodes = search_bench_positions();
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timer.elapsed()).count();
+
+        std::lock_guard io { output_mutex };
+        std::cout << std::setw(8) << hash << std::setw(12) << nodes << std::setw(10) << elapsed_ms;
+        print_tt_hit_rate(std::cout, 10);
+        std::cout << std::endl;
+    }
+
+    handle_setoption_threads(old_threads);
+    handle_setoption_hash(old_hash);
+    search_thread_pool.reset_new_game();
+    output.output_level = old_output_level;
+}
+
 auto Uci::options_handler()
 {
 #define tuneable_int(name, min_, max_)                                                                                 \
@@ -275,10 +808,16 @@ auto Uci::options_handler()
     return Options {
         ButtonOption { "Clear Hash", [this] { handle_setoption_clear_hash(); } },
         CheckOption { "UCI_Chess960", false, [this](bool value) { handle_setoption_chess960(value); } },
+        // we support pondering regardless, but GUIs will only send 'go ponder' if we advertise this option
+        CheckOption { "Ponder", false, [](bool) {} },
         SpinOption { "Hash", 32, 1, 262144, [this](auto value) { handle_setoption_hash(value); } },
         SpinOption { "Threads", 1, 1, 1024, [this](auto value) { handle_setoption_threads(value); } },
         SpinOption { "MultiPV", 1, 1, MAX_LEGAL_MOVES, [this](auto value) { handle_setoption_multipv(value); } },
         StringOption { "SyzygyPath", "<empty>", [this](auto value) { handle_setoption_syzygy_path(value); } },
+        StringOption { "EvalFile", "<internal>", [this](auto value) { return handle_setoption_eval_file(value); } },
+        // per thread, in KiB
+        SpinOption { "EvalCache", 0, 0, 65536, [this](auto value) { handle_setoption_eval_cache(value); } },
+        CheckOption { "IntegerInference", false, [this](bool value) { handle_setoption_integer_inference(value); } },
         ComboOption {
             "OutputLevel", OutputLevel::Default, [this](auto value) { handle_setoption_output_level(value); } },
 
@@ -465,6 +1004,9 @@ void Uci::handle_uci()
 
 void Uci::handle_isready()
 {
+    // a hash resize runs in the background, so the engine is only ready once it has finished
+    search_thread_pool.finish_hash_resize();
+
     std::lock_guard io { output_mutex };
     std::cout << "readyok" << std::endl;
 }
@@ -493,9 +1035,13 @@ void Uci::handle_go(const SearchLimits& limits)
 {
     // TODO: we could do this before the go command to save time
     search_thread_pool.set_position(position);
+    search_thread_pool.set_pondering(limits.ponder);
+
+    // the limits are set on this thread, because a ponderhit can arrive before the search thread gets to them
+    search_thread_pool.set_limits(limits);
 
     // launch search thread
-    main_search_thread = std::thread([this, limits]() { search_thread_pool.launch_search(limits); });
+    main_search_thread = std::thread([this]() { search_thread_pool.launch_search(); });
 }
 
 void Uci::handle_setoption_clear_hash()
@@ -518,6 +1064,22 @@ void Uci::handle_setoption_syzygy_path(std::string_view value)
     Syzygy::init(value, output.output_level > OutputLevel::None && finished_startup);
 }
 
+bool Uci::handle_setoption_eval_file(std::string_view value)
+{
+    return NN::load_network(value, output.output_level > OutputLevel::None && finished_startup);
+}
+
+void Uci::handle_setoption_eval_cache(int value)
+{
+    NN::set_eval_cache_size(value);
+}
+
+void Uci::handle_setoption_integer_inference(bool value)
+{
+    integer_inference = value;
+    NN::set_integer_inference(value);
+}
+
 void Uci::handle_setoption_multipv(int value)
 {
     search_thread_pool.set_multi_pv(value);
@@ -538,6 +1100,11 @@ void Uci::handle_stop()
     search_thread_pool.stop_search();
 }
 
+void Uci::handle_ponderhit()
+{
+    search_thread_pool.ponderhit();
+}
+
 void Uci::handle_quit()
 {
     search_thread_pool.stop_search();
@@ -570,6 +1137,8 @@ void Uci::process_input(std::string_view command)
     auto during_search_processor = Sequence {
     OneOf { 
         Consume { "stop", Invoke { [this] { handle_stop(); } } },
+        Consume { "ponderhit", Invoke { [this] { handle_ponderhit(); } } },
+        Consume { "isready", Invoke { [this] { handle_isready(); } } },
         Consume { "quit", Invoke { [this] { handle_quit(); } } } },
     EndCommand{}
     };
@@ -591,6 +1160,7 @@ void Uci::process_input(std::string_view command)
     auto search_limits_handler_factory = [](){ 
         return Repeat { OneOf {
             Consume { "infinite", Invoke { [](auto&){} } },
+            Consume { "ponder", Invoke { [](auto& ctx){ ctx.ponder = true; } } },
             Consume { "wtime", NextToken { ToInt { [](auto value, auto& ctx){ ctx.wtime = value * 1ms; } } } },
             Consume { "btime", NextToken { ToInt { [](auto value, auto& ctx){ ctx.btime = value * 1ms; } } } },
             Consume { "winc", NextToken { ToInt { [](auto value, auto& ctx){ ctx.winc = value * 1ms; } } } },
@@ -615,7 +1185,11 @@ void Uci::process_input(std::string_view command)
         Consume { "setoption", options_handler_model.build_handler() },
 
         // extensions
-        Consume { "perft", NextToken { ToInt { [this](auto value) { PerftDivide(value, position, false); } } } },
+        Consume { "perft", WithContext { perft_ctx{}, Sequence {
+            NextToken { ToInt { [](auto value, auto& ctx){ ctx.depth = value; } } },
+            Repeat { OneOf {
+                Consume { "hash", NextToken { ToInt { [](auto value, auto& ctx){ ctx.hash_mb = value; return value >= 0; } } } } } },
+            Invoke { [this](auto& ctx) { PerftDivide(ctx.depth, position, false, ctx.hash_mb); } } } } },
         Consume { "test", OneOf {
             Consume { "perft", Invoke { [] { PerftSuite("test/perftsuite.txt", 0, false); } } },
             Consume { "perft960", Invoke { [] { PerftSuite("test/perft960.txt", 0, false); } } },
@@ -623,6 +1197,18 @@ void Uci::process_input(std::string_view command)
             Consume { "perft960_legality", Invoke { [] { PerftSuite("test/perft960.txt", 3, true); } } } } },
         Consume { "bench", OneOf  {
             Sequence { EndCommand{}, Invoke { [this]{ handle_bench(SearchLimits{.depth = 14}); } } },
+            Consume { "tt", Invoke { [this]{ handle_bench_tt(); } } },
+            Consume { "eval-batch", Invoke { [this]{ handle_bench_eval_batch(); } } },
+            Consume { "nnue", Invoke { [this]{ handle_bench_nnue(); } } },
+            Consume { "eval-int", WithContext { go_ctx{ .depth = 10 }, Sequence {
+                search_limits_handler_factory(),
+                Invoke { [this](auto& ctx) { handle_bench_eval_int(parse_search_limits(ctx)); } } } } },
+            Consume { "smp", WithContext { go_ctx{ .depth = 12 }, Sequence {
+                search_limits_handler_factory(),
+                Invoke { [this](auto& ctx) { handle_bench_smp(parse_search_limits(ctx)); } } } } },
+            Consume { "tt-replacement", WithContext { go_ctx{ .depth = 10 }, Sequence {
+                search_limits_handler_factory(),
+                Invoke { [this](auto& ctx) { handle_bench_tt_replacement(parse_search_limits(ctx)); } } } } },
             WithContext { go_ctx{}, Sequence {
                 search_limits_handler_factory(),
                 Invoke { [this](auto& ctx) { handle_bench(parse_search_limits(ctx)); } } } } } },
@@ -630,11 +1216,20 @@ void Uci::process_input(std::string_view command)
         Consume { "spsa", Invoke { [this] { handle_spsa(); } } },
         Consume { "eval", Invoke { [this] { handle_eval(); } } },
         Consume { "probe", Invoke { [this] { handle_probe(); } } },
+        Consume { "savehash", NextToken { [this](auto value) { handle_savehash(value); } } },
+        Consume { "loadhash", NextToken { [this](auto value) { handle_loadhash(value); } } },
+        Consume { "hashstats", OneOf {
+            Sequence { EndCommand{}, Invoke { [this] { handle_hashstats(false); } } },
+            Consume { "reset", Invoke { [this] { handle_hashstats(true); } } } } },
+        Consume { "netstats", OneOf {
+            Sequence { EndCommand{}, Invoke { [this] { handle_netstats(false); } } },
+            Consume { "reset", Invoke { [this] { handle_netstats(true); } } } } },
         Consume { "shuffle_network", Invoke { [this] { handle_shuffle_network(); } } },
         Consume { "datagen", WithContext { datagen_ctx{}, Sequence {
             Repeat { OneOf {
                 Consume { "output", NextToken { [](auto value, auto& ctx){ ctx.output_path = value; } } },
-                Consume { "duration", NextToken { ToInt { [](auto value, auto& ctx){ ctx.duration = value * 1s;} } } } } },
+                Consume { "duration", NextToken { ToInt { [](auto value, auto& ctx){ ctx.duration = value * 1s;} } } },
+                Consume { "threads", NextToken { ToInt { [](auto value, auto& ctx){ ctx.threads = value; return value >= 1; } } } } } },
             Invoke { [this](auto& ctx) { handle_datagen(ctx); } } } } } },
     EndCommand{}
     };
@@ -689,9 +1284,84 @@ void Uci::handle_probe()
     std::cout << std::endl;
 }
 
+void Uci::handle_savehash(std::string_view path)
+{
+    Timer timer;
+    auto error = search_thread_pool.save_hash(std::string(path), position.board().half_turn_count);
+    const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timer.elapsed()).count();
+
+    std::lock_guard io { output_mutex };
+    if (error)
+    {
+        std::cout << "info string Error: hash file " << path << " " << *error << std::endl;
+    }
+    else if (output.output_level > OutputLevel::None)
+    {
+        std::cout << "info string Saved hash to " << path << " in " << elapsed_ms << "ms" << std::endl;
+    }
+}
+
+void Uci::handle_loadhash(std::string_view path)
+{
+    Timer timer;
+    auto error = search_thread_pool.load_hash(std::string(path), position.board().half_turn_count);
+    const auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(timer.elapsed()).count();
+
+    std::lock_guard io { output_mutex };
+    if (error)
+    {
+        std::cout << "info string Error: hash file " << path << " " << *error << std::endl;
+    }
+    else if (output.output_level > OutputLevel::None)
+    {
+        std::cout << "info string Loaded hash from " << path << " in " << elapsed_ms << "ms" << std::endl;
+    }
+}
+
+void Uci::handle_netstats(bool reset)
+{
+    std::lock_guard io { output_mutex };
+    if constexpr (!NN::Stats::enabled)
+    {
+        std::cout << "info string network stats are not compiled in, rebuild with make "
+                     "EXTRA_CXXFLAGS=-DNETWORK_STATS"
+                  << std::endl;
+        return;
+    }
+
+    if (reset)
+    {
+        NN::Stats::reset();
+        return;
+    }
+
+    NN::Stats::print(std::cout);
+    std::cout << std::flush;
+}
+
+void Uci::handle_hashstats(bool reset)
+{
+    std::lock_guard io { output_mutex };
+    if constexpr (!Transposition::Stats::enabled)
+    {
+        std::cout << "info string hash stats are not compiled in, rebuild with make EXTRA_CXXFLAGS=-DTT_STATS"
+                  << std::endl;
+        return;
+    }
+
+    if (reset)
+    {
+        Transposition::Stats::reset();
+        return;
+    }
+
+    Transposition::Stats::print(std::cout);
+    std::cout << std::flush;
+}
+
 void Uci::handle_datagen(const datagen_ctx& ctx)
 {
-    datagen(ctx.output_path, ctx.duration);
+    datagen(ctx.output_path, ctx.duration, ctx.threads);
 }
 
 void UciOutput::print_search_info(const SearchInfoData& data, bool final, bool format_960)
@@ -747,7 +1417,7 @@ void UciOutput::print_search_info(const SearchInfoData& data, bool final, bool f
     std::cout << std::endl;
 }
 
-void UciOutput::print_bestmove(bool chess960, std::optional<Move> move)
+void UciOutput::print_bestmove(bool chess960, std::optional<Move> move, std::optional<Move> ponder)
 {
     if (output_level > OutputLevel::None)
     {
@@ -759,11 +1429,21 @@ void UciOutput::print_bestmove(bool chess960, std::optional<Move> move)
         }
         else if (chess960)
         {
-            std::cout << "bestmove " << format_chess960 { *move } << std::endl;
+            std::cout << "bestmove " << format_chess960 { *move };
+            if (ponder.has_value())
+            {
+                std::cout << " ponder " << format_chess960 { *ponder };
+            }
+            std::cout << std::endl;
         }
         else
         {
-            std::cout << "bestmove " << *move << std::endl;
+            std::cout << "bestmove " << *move;
+            if (ponder.has_value())
+            {
+                std::cout << " ponder " << *ponder;
+            }
+            std::cout << std::endl;
         }
     }
 }
@@ -788,6 +1468,7 @@ SearchLimits Uci::parse_search_limits(const go_ctx& ctx)
     limits.mate = ctx.mate;
     limits.depth = ctx.depth;
     limits.nodes = ctx.nodes;
+    limits.ponder = ctx.ponder;
     limits.time = {};
 
     using namespace std::chrono_literals;
@@ -57,12 +57,20 @@ public:
         std::optional<int> mate;
         std::optional<int> depth;
         std::optional<int> nodes;
+        bool ponder = false;
+    };
+
+    struct perft_ctx
+    {
+        int depth = 0;
+        int hash_mb = 0;
     };
 
     struct datagen_ctx
     {
         std::string output_path;
         std::chrono::seconds duration;
+        int threads = 1;
     };
 
     void handle_uci();
@@ -76,16 +84,30 @@ public:
     void handle_setoption_hash(int value);
     void handle_setoption_threads(int value);
     void handle_setoption_syzygy_path(std::string_view value);
+    bool handle_setoption_eval_file(std::string_view value);
+    void handle_setoption_eval_cache(int value);
+    void handle_setoption_integer_inference(bool value);
     void handle_setoption_multipv(int value);
     void handle_setoption_chess960(bool value);
     void handle_setoption_output_level(OutputLevel level);
     void handle_stop();
+    void handle_ponderhit();
     void handle_quit();
     void handle_bench(const SearchLimits& limits);
+    void handle_bench_tt();
+    void handle_bench_smp(const SearchLimits& limits);
+    void handle_bench_tt_replacement(const SearchLimits& limits);
+    void handle_bench_eval_batch();
+    void handle_bench_eval_int(const SearchLimits& limits);
+    void handle_bench_nnue();
     void handle_spsa();
     void handle_print();
     void handle_eval();
     void handle_probe();
+    void handle_savehash(std::string_view path);
+    void handle_loadhash(std::string_view path);
+    void handle_netstats(bool reset);
+    void handle_hashstats(bool reset);
     void handle_datagen(const datagen_ctx& ctx);
     void handle_shuffle_network();
 
@@ -101,6 +123,7 @@ private:
     GameState position = GameState::starting_position();
     bool quit = false;
     bool finished_startup = false;
+    bool integer_inference = false;
 
     auto options_handler();
     auto position_command_handler();
@@ -113,7 +136,7 @@ public:
     OutputLevel output_level = OutputLevel::Default;
 
     void print_search_info(const SearchInfoData& data, bool final = false, bool format_960 = false);
-    void print_bestmove(bool chess960, std::optional<Move> move);
+    void print_bestmove(bool chess960, std::optional<Move> move, std::optional<Move> ponder = std::nullopt);
     void print_error(const std::string& error_str);
 };
 
@@ -85,4 +85,9 @@ std::string fmt_version_platform_arch(std::string_view version)
     static constexpr auto arch = get_arch();
     // std::format requires gcc 13+
     return (std::stringstream() << "Halogen " << version << " " << platform << " " << arch).str();
-}
\ No newline at end of file
+}
+
+std::string_view arch_name()
+{
+    return get_arch();
+}
@@ -3,4 +3,7 @@
 #include <string>
 #include <string_view>
 
-std::string fmt_version_platform_arch(std::string_view version);
\ No newline at end of file
+std::string fmt_version_platform_arch(std::string_view version);
+
+// The instruction set extensions this binary was compiled for, e.g. "AVX2"
+std::string_view arch_name();
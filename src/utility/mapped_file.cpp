@@ -0,0 +1,122 @@
+#include "utility/mapped_file.h"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    HANDLE file = CreateFileA(
+        path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return nullptr;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!data)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> mapped_file(new MappedFile);
+    mapped_file->data_ = static_cast<const std::byte*>(data);
+    mapped_file->size_ = static_cast<size_t>(size.QuadPart);
+    mapped_file->file_handle_ = file;
+    mapped_file->mapping_handle_ = mapping;
+    return mapped_file;
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_handle_);
+    CloseHandle(file_handle_);
+}
+
+#else
+
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || st.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef __linux__
+    // fault the whole file in up front, rather than stalling the first search on page faults
+    flags |= MAP_POPULATE;
+#endif
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, flags, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+    {
+        return nullptr;
+    }
+
+#ifdef __linux__
+    // Ask for transparent huge pages. This is best effort: it only takes effect where the kernel supports huge pages
+    // for file mappings (or the file lives on hugetlbfs), but when it does it saves a lot of TLB misses.
+    madvise(data, st.st_size, MADV_HUGEPAGE);
+#endif
+
+    std::unique_ptr<MappedFile> mapped_file(new MappedFile);
+    mapped_file->data_ = static_cast<const std::byte*>(data);
+    mapped_file->size_ = static_cast<size_t>(st.st_size);
+    return mapped_file;
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<std::byte*>(data_), size_);
+}
+
+#endif
+
+const std::byte* MappedFile::data() const
+{
+    return data_;
+}
+
+size_t MappedFile::size() const
+{
+    return size_;
+}
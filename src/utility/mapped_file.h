@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// A read-only memory mapping of a file. The mapping is shared, so every process that maps the same file reads the
+// same page cache pages rather than each holding a private copy of the contents.
+class MappedFile
+{
+public:
+    // returns nullptr if the file could not be opened or mapped
+    [[nodiscard]] static std::unique_ptr<MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    [[nodiscard]] const std::byte* data() const;
+    [[nodiscard]] size_t size() const;
+
+private:
+    MappedFile() = default;
+
+    const std::byte* data_ = nullptr;
+    size_t size_ = 0;
+
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#endif
+};